@@ -0,0 +1,75 @@
+#include "cas_stats.h"
+
+#include "utils.h"
+
+#if defined(SLT_TS_CAS_STATS)
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::vector<std::pair<std::string, sltts::CasStats>> &get_cas_stats() {
+  static std::vector<std::pair<std::string, sltts::CasStats>> stats;
+  return stats;
+}
+
+} // namespace
+
+namespace sltts {
+
+void CasStats::merge(const CasStats &other) {
+  n_attempts += other.n_attempts;
+  n_failures += other.n_failures;
+  n_updates += other.n_updates;
+  for (int i = 0; i < n_buckets; ++i)
+    histogram[i] += other.histogram[i];
+}
+
+void CasStats::log(const char *name) const {
+  log_status_param(name, "", 2);
+  log_status_param("attempts", n_attempts, 4);
+  log_status_param("failures", n_failures, 4);
+  log_status_param("updates", n_updates, 4);
+  log_status_param("failures per update",
+                   n_updates ? static_cast<double>(n_failures) / n_updates : 0.,
+                   4);
+  log_status_param("retries histogram", "", 4);
+  for (int i = 0; i < n_buckets; ++i) {
+    std::string range;
+    if (i == 0)
+      range = "0";
+    else if (i == 1)
+      range = "1";
+    else if (i + 1 == n_buckets)
+      range = std::to_string(1ULL << (i - 1)) + "+";
+    else
+      range = std::to_string(1ULL << (i - 1)) + "-" +
+              std::to_string((1ULL << i) - 1);
+    log_status_param(range.c_str(), histogram[i], 6);
+  }
+}
+
+void add_cas_stats(const char *name, const CasStats &stats) {
+  for (auto &named_stats : get_cas_stats()) {
+    if (named_stats.first == name) {
+      named_stats.second.merge(stats);
+      return;
+    }
+  }
+  get_cas_stats().push_back(std::make_pair(std::string(name), stats));
+}
+
+void log_cas_stats() {
+  if (get_cas_stats().empty())
+    return;
+
+  log_status("CAS stats:\n");
+  for (const auto &named_stats : get_cas_stats())
+    named_stats.second.log(named_stats.first.c_str());
+}
+
+} // namespace sltts
+
+#endif // SLT_TS_CAS_STATS
@@ -0,0 +1,70 @@
+#ifndef SLT_TS_CPPATOMICS_CAS_STATS_H
+#define SLT_TS_CPPATOMICS_CAS_STATS_H
+
+#include <cstdint>
+
+namespace sltts {
+
+/// Statistics of CAS loops done by one thread: attempts, failures and
+/// histogram of failed attempts before successful update. Instance is owned
+/// by a single thread, so recording is a few plain increments. Instances are
+/// merged after threads are joined.
+///
+/// Collection is compiled in only if SLT_TS_CAS_STATS is defined (CMake
+/// option of the same name), otherwise all functions are empty.
+class CasStats {
+public:
+  /// Buckets of retries histogram: 0, 1, 2-3, 4-7, ..., 128-255, 256+.
+  static const int n_buckets = 10;
+
+#if defined(SLT_TS_CAS_STATS)
+  /// Record one CAS loop which failed |n_failures| times and then either
+  /// updated the value (|updated| is true) or gave up.
+  void add_loop(std::uint64_t n_failures, bool updated) {
+    n_attempts += n_failures + (updated ? 1 : 0);
+    this->n_failures += n_failures;
+    if (!updated)
+      return;
+    ++n_updates;
+    ++histogram[get_bucket(n_failures)];
+  }
+
+  void merge(const CasStats &other);
+
+  void log(const char *name) const;
+
+private:
+  static int get_bucket(std::uint64_t n_failures) {
+    int bucket = 0;
+    while (n_failures && bucket + 1 < n_buckets) {
+      n_failures >>= 1;
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  std::uint64_t n_attempts = 0;
+  std::uint64_t n_failures = 0;
+  std::uint64_t n_updates = 0;
+  std::uint64_t histogram[n_buckets] = {};
+#else
+  void add_loop(std::uint64_t, bool) {}
+  void merge(const CasStats &) {}
+  void log(const char *) const {}
+#endif
+};
+
+#if defined(SLT_TS_CAS_STATS)
+/// Accumulate |stats| under |name|, accumulated stats are printed by
+/// log_cas_stats() in order of first registration.
+void add_cas_stats(const char *name, const CasStats &stats);
+
+void log_cas_stats();
+#else
+inline void add_cas_stats(const char *, const CasStats &) {}
+inline void log_cas_stats() {}
+#endif
+
+} // namespace sltts
+
+#endif // SLT_TS_CPPATOMICS_CAS_STATS_H
@@ -0,0 +1,190 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace sltts;
+
+// Nodes come from a pool and are never freed, so ABA corrupts the stack
+// (nodes are lost or handed out twice) but never touches freed memory.
+struct Node {
+  std::atomic<Node *> next{nullptr};
+  std::atomic<bool> in_use{false};
+};
+
+// Head is {pointer, tag} pair updated with double-width CAS. Tag is bumped on
+// every successful update, so stale head with the same pointer does not
+// compare equal. With |UseTag| = false tag stays zero and ABA is possible.
+struct TaggedPtr {
+  Node *ptr;
+  std::uintptr_t tag;
+};
+
+template <bool UseTag> class TreiberStack {
+public:
+  void push(Node *node) {
+    TaggedPtr old_head = head.load(std::memory_order_relaxed);
+    TaggedPtr new_head;
+    do {
+      node->next.store(old_head.ptr, std::memory_order_relaxed);
+      new_head = TaggedPtr{node, next_tag(old_head)};
+    } while (!head.compare_exchange_weak(old_head, new_head,
+                                         std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  Node *pop() {
+    TaggedPtr old_head = head.load(std::memory_order_acquire);
+    while (old_head.ptr) {
+      // Node may be popped and pushed again concurrently, next is atomic to
+      // make this read well defined. Stale value is rejected by CAS on tag.
+      Node *next = old_head.ptr->next.load(std::memory_order_relaxed);
+      const TaggedPtr new_head{next, next_tag(old_head)};
+      if (head.compare_exchange_weak(old_head, new_head,
+                                     std::memory_order_acquire,
+                                     std::memory_order_acquire))
+        return old_head.ptr;
+    }
+    return nullptr;
+  }
+
+  Node *top() const { return head.load(std::memory_order_acquire).ptr; }
+
+  bool is_lock_free() const { return head.is_lock_free(); }
+
+private:
+  static std::uintptr_t next_tag(const TaggedPtr &p) {
+    return UseTag ? p.tag + 1 : 0;
+  }
+
+  std::atomic<TaggedPtr> head{TaggedPtr{nullptr, 0}};
+};
+
+// Each thread pops two nodes, marks them as owned and pushes them back one by
+// one. Pushing the first node back while the second one is held returns the
+// same pointer to the head, which is the ABA window for concurrent pops.
+// Returns false if a node was handed out twice or is missing in the end.
+template <bool UseTag> bool run_stack(int n, int n_thr, int pool_size) {
+  std::vector<Node> pool(pool_size);
+  TreiberStack<UseTag> stack;
+  for (Node &node : pool)
+    stack.push(&node);
+
+  std::atomic<bool> fence{true};
+  std::atomic<bool> succeed{true};
+  std::atomic<std::uint64_t> n_ops{0};
+
+  std::vector<std::thread> threads;
+  threads.reserve(n_thr);
+  for (int t = 0; t < n_thr; ++t) {
+    threads.emplace_back([n, &stack, &fence, &succeed, &n_ops]() {
+      while (fence.load(std::memory_order_relaxed))
+        ;
+
+      std::uint64_t ops = 0;
+      for (int i = 0; i < n; ++i) {
+        Node *owned[2] = {stack.pop(), stack.pop()};
+        for (Node *node : owned) {
+          if (!node)
+            continue;
+          ++ops;
+          if (node->in_use.exchange(true, std::memory_order_relaxed))
+            succeed.store(false, std::memory_order_relaxed);
+        }
+        for (Node *node : owned) {
+          if (!node)
+            continue;
+          ++ops;
+          node->in_use.store(false, std::memory_order_relaxed);
+          stack.push(node);
+        }
+      }
+      n_ops.fetch_add(ops, std::memory_order_relaxed);
+    });
+  }
+
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
+
+  for (std::thread &t : threads)
+    t.join();
+
+  add_rate_metric(SLT_PRETTY_FUNCTION, "push/pop ops",
+                  n_ops.load(std::memory_order_relaxed),
+                  get_time_ns() - start_ns);
+
+  // Every node must be in the stack exactly once. Corrupted stack may have a
+  // cycle, so walk at most pool_size + 1 nodes.
+  std::vector<bool> seen(pool_size, false);
+  int n_nodes = 0;
+  for (Node *node = stack.top(); node && n_nodes <= pool_size;
+       node = node->next.load(std::memory_order_relaxed), ++n_nodes) {
+    const std::size_t ix = node - pool.data();
+    if (seen[ix])
+      return false;
+    seen[ix] = true;
+  }
+
+  return succeed.load(std::memory_order_relaxed) && n_nodes == pool_size;
+}
+
+bool test_tagged(int n, int n_thr, int pool_size) {
+  if (!run_stack<true>(n, n_thr, pool_size)) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    log_status_param("num threads", n_thr, 2);
+    log_status_param("pool size", pool_size, 2);
+    return false;
+  }
+  return true;
+}
+
+// ABA is expected without tag, so corruption is only reported as frequency.
+void test_untagged(int n, int n_thr, int pool_size) {
+  const bool corrupted = !run_stack<false>(n, n_thr, pool_size);
+  add_frequency_metric(SLT_PRETTY_FUNCTION, "runs with corrupted stack",
+                       corrupted, 1);
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--count v1] [--num_threads v2] [--pool_size v3]\n",
+                argv[0]);
+    return 0;
+  }
+
+  int count = 100000;
+  int n_threads = 4;
+  int pool_size = 8;
+  if (!get_arg_pos_i(argc, argv, "--count", &count) ||
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads) ||
+      !get_arg_pos_i(argc, argv, "--pool_size", &pool_size))
+    return 1;
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("count", count, 2);
+  log_status_param("num threads", n_threads, 2);
+  log_status_param("pool size", pool_size, 2);
+  log_status_param("head size", static_cast<int>(sizeof(TaggedPtr)), 2);
+  log_status_param("head is lock free",
+                   static_cast<int>(TreiberStack<true>().is_lock_free()), 2);
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_tagged(count, n_threads, pool_size);
+    test_untagged(count, n_threads, pool_size);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
@@ -1,3 +1,5 @@
+#include "cas_stats.h"
+#include "metrics.h"
 #include "slt_ts.h"
 #include "utils.h"
 
@@ -24,16 +26,21 @@ template <typename T> bool test() {
     count_flag.store(1, std::memory_order_release);
   });
 
-  std::thread t_intermed([&count_flag, &fence, &data, &succeed]() {
+  CasStats stats;
+  std::thread t_intermed([&count_flag, &fence, &data, &succeed, &stats]() {
     while (fence.load(std::memory_order_relaxed))
       ;
     T expected = 1;
+    std::uint64_t n_failures = 0;
     // memory_order_relaxed is okay because this is an RMW,
     // and RMWs (with any ordering) following a release form a release
     // sequence
     while (!count_flag.compare_exchange_strong(expected, T(2),
-                                               std::memory_order_relaxed))
+                                               std::memory_order_relaxed)) {
       expected = 1;
+      ++n_failures;
+    }
+    stats.add_loop(n_failures, true);
   });
 
   std::thread t_consumer([&count_flag, &data, &succeed]() {
@@ -49,6 +56,8 @@ template <typename T> bool test() {
   t_intermed.join();
   t_consumer.join();
 
+  add_cas_stats(SLT_PRETTY_FUNCTION, stats);
+
   if (!succeed.load(std::memory_order_relaxed)) {
     log_status("Failed test\n");
     log_status_param("function", SLT_PRETTY_FUNCTION, 2);
@@ -74,6 +83,9 @@ int main(int argc, const char **argv) {
     return succeed;
   });
 
+  log_cas_stats();
+  succeed &= report_metrics(__FILE__, succeed);
+
   std::puts(succeed ? "passed" : "failed");
   return succeed ? 0 : 1;
 }
@@ -0,0 +1,129 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace sltts;
+
+// Producer fills fresh node and publishes pointer to it, consumers read node
+// fields through the loaded pointer, so there is a real dependency chain from
+// the atomic load to the data. Nodes are never reused, pool is zeroed before
+// the test, so reading not yet initialized node is detected by check fields.
+template <typename T> struct Node {
+  std::uint32_t seq;
+  T value;
+  T inv_value;
+};
+
+template <typename T, std::memory_order LoadOrder>
+bool test(int n, int n_consumers) {
+  std::vector<Node<T>> pool(n);
+
+  std::atomic<bool> fence{true};
+  std::atomic<const Node<T> *> head{nullptr};
+  std::atomic<bool> succeed{true};
+  std::atomic<std::uint64_t> n_loads{0};
+
+  std::thread t_producer([n, &pool, &head, &fence]() {
+    while (fence.load(std::memory_order_relaxed))
+      ;
+    for (int i = 0; i < n; ++i) {
+      Node<T> &node = pool[i];
+      node.seq = i + 1;
+      node.value = T(i);
+      node.inv_value = T(~T(i));
+      head.store(&node, std::memory_order_release);
+    }
+  });
+
+  std::vector<std::thread> consumers;
+  consumers.reserve(n_consumers);
+  for (int t = 0; t < n_consumers; ++t) {
+    consumers.emplace_back([n, &head, &fence, &succeed, &n_loads]() {
+      while (fence.load(std::memory_order_relaxed))
+        ;
+      std::uint64_t loads = 0;
+      std::uint32_t prev_seq = 0;
+      while (prev_seq != static_cast<std::uint32_t>(n)) {
+        const Node<T> *p = head.load(LoadOrder);
+        if (!p)
+          continue;
+        ++loads;
+        const std::uint32_t seq = p->seq;
+        if (seq < prev_seq || seq == 0 || p->value != T(seq - 1) ||
+            p->inv_value != T(~T(seq - 1))) {
+          succeed.store(false, std::memory_order_relaxed);
+          break;
+        }
+        prev_seq = seq;
+      }
+      n_loads.fetch_add(loads, std::memory_order_relaxed);
+    });
+  }
+
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
+
+  t_producer.join();
+  const std::uint64_t producer_ns = get_time_ns() - start_ns;
+  for (std::thread &t : consumers)
+    t.join();
+  const std::uint64_t consumers_ns = get_time_ns() - start_ns;
+
+  add_rate_metric(SLT_PRETTY_FUNCTION, "publications", n, producer_ns);
+  add_rate_metric(SLT_PRETTY_FUNCTION, "dependent loads",
+                  n_loads.load(std::memory_order_relaxed), consumers_ns);
+
+  if (!succeed.load(std::memory_order_relaxed)) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    log_status_param("num consumers", n_consumers, 2);
+    return false;
+  }
+  return true;
+}
+
+template <typename T> bool test_orders(int n, int n_consumers) {
+  bool succeed = true;
+  succeed &= test<T, std::memory_order_consume>(n, n_consumers);
+  succeed &= test<T, std::memory_order_acquire>(n, n_consumers);
+  return succeed;
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--count v1] [--num_threads v2]\n", argv[0]);
+    return 0;
+  }
+
+  int count = 100000;
+  int n_threads = 2;
+  if (!get_arg_pos_i(argc, argv, "--count", &count) ||
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads))
+    return 1;
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("count", count, 2);
+  log_status_param("num threads", n_threads, 2);
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_orders<std::uint8_t>(count, n_threads);
+    succeed &= test_orders<std::uint16_t>(count, n_threads);
+    succeed &= test_orders<std::uint32_t>(count, n_threads);
+    succeed &= test_orders<std::uint64_t>(count, n_threads);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
@@ -1,58 +1,102 @@
+#include "cas_stats.h"
+#include "metrics.h"
 #include "slt_ts.h"
 #include "utils.h"
+#include "work_split.h"
 
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <string>
 #include <thread>
 #include <vector>
 
 using namespace sltts;
 
-template <typename T> T parallel_max(const std::vector<T> &v, int n_thr) {
+// Elements are distributed between threads by SplitT, time from start to
+// finish of every thread is written to |thread_ns|.
+template <typename T, typename SplitT>
+T parallel_max(const std::vector<T> &v, int n_thr, int chunk_size,
+               CasStats *stats, std::vector<std::uint64_t> *thread_ns) {
   std::atomic<T> rv{0};
   std::atomic<bool> fence{true};
+  SplitT split(v.size(), n_thr, chunk_size);
+  std::vector<CasStats> thread_stats(n_thr);
+  std::vector<std::uint64_t> finish_ns(n_thr);
 
   std::vector<std::thread> threads;
   threads.reserve(n_thr);
   for (int t = 0; t < n_thr; ++t) {
-    threads.emplace_back([t, n_thr, &v, &rv, &fence]() {
-      const int bucket_size = v.size() / n_thr;
-      const int start_ix = t * bucket_size;
-      const int final_ix = t + 1 == n_thr ? v.size() : start_ix + bucket_size;
-
-      while (fence.load(std::memory_order_relaxed))
-        ;
-
-      for (int i = start_ix; i < final_ix; ++i) {
-        const T value = v[i];
-        T curr_max = rv.load(std::memory_order_relaxed);
-        // >= for more pressure on atomic var.
-        while (value >= curr_max &&
-               !rv.compare_exchange_weak(curr_max, value,
-                                         std::memory_order_relaxed,
-                                         std::memory_order_relaxed))
-          ;
-      }
-    });
+    threads.emplace_back(
+        [t, &v, &rv, &fence, &split, &thread_stats, &finish_ns]() {
+          CasStats my_stats;
+
+          while (fence.load(std::memory_order_relaxed))
+            ;
+
+          int start_ix = 0;
+          int final_ix = 0;
+          while (split.next(t, &start_ix, &final_ix)) {
+            for (int i = start_ix; i < final_ix; ++i) {
+              const T value = v[i];
+              T curr_max = rv.load(std::memory_order_relaxed);
+              std::uint64_t n_failures = 0;
+              bool updated = false;
+              // >= for more pressure on atomic var.
+              while (value >= curr_max) {
+                if (rv.compare_exchange_weak(curr_max, value,
+                                             std::memory_order_relaxed,
+                                             std::memory_order_relaxed)) {
+                  updated = true;
+                  break;
+                }
+                ++n_failures;
+              }
+              my_stats.add_loop(n_failures, updated);
+            }
+          }
+          finish_ns[t] = get_time_ns();
+
+          thread_stats[t] = my_stats;
+        });
   }
 
-  fence.store(std::memory_order_relaxed);
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
 
   for (std::thread &t : threads)
     t.join();
 
+  for (const CasStats &s : thread_stats)
+    stats->merge(s);
+
+  thread_ns->resize(n_thr);
+  for (int t = 0; t < n_thr; ++t)
+    (*thread_ns)[t] = finish_ns[t] - start_ns;
+
   return rv.load(std::memory_order_relaxed);
 }
 
-template <typename T> bool test(const int n, int n_thr) {
+template <typename T, typename SplitT>
+bool test(const int n, int n_thr, int chunk_size) {
   std::vector<T> v(n);
   for (int i = 0; i < n; ++i)
     v[i] = T(i % (n / n_thr));
 
-  const T act_res = parallel_max(v, n_thr);
+  CasStats stats;
+  std::vector<std::uint64_t> thread_ns;
+  const std::uint64_t start_ns = get_time_ns();
+  const T act_res =
+      parallel_max<T, SplitT>(v, n_thr, chunk_size, &stats, &thread_ns);
+  add_rate_metric(SLT_PRETTY_FUNCTION, "elements", n, get_time_ns() - start_ns);
+  add_cost_metric(SLT_PRETTY_FUNCTION, "thread time spread (max - min) / mean",
+                  get_imbalance(thread_ns));
+
+  const std::string name = std::string(SLT_PRETTY_FUNCTION) + ", num threads " +
+                           std::to_string(n_thr);
+  add_cas_stats(name.c_str(), stats);
   const T exp_res = *std::max_element(v.begin(), v.end());
 
   if (act_res != exp_res) {
@@ -60,6 +104,7 @@ template <typename T> bool test(const int n, int n_thr) {
     log_status_param("function", SLT_PRETTY_FUNCTION, 2);
     log_status_param("array size", n, 2);
     log_status_param("num threads", n_thr, 2);
+    log_status_param("chunk size", chunk_size, 2);
     log_status_param("act result", act_res, 2);
     log_status_param("exp result", exp_res, 2);
     return false;
@@ -67,16 +112,28 @@ template <typename T> bool test(const int n, int n_thr) {
   return true;
 }
 
+template <typename T> bool test_splits(const int n, int n_thr, int chunk_size) {
+  bool succeed = true;
+  succeed &= test<T, StaticSplit>(n, n_thr, chunk_size);
+  succeed &= test<T, ChunkedSplit>(n, n_thr, chunk_size);
+  succeed &= test<T, StealingSplit>(n, n_thr, chunk_size);
+  return succeed;
+}
+
 int main(int argc, const char **argv) {
   if (argc == 2 && !strcmp(argv[1], "-h")) {
-    std::printf("Usage: %s [--array_size v1] [--num_threads v2]\n", argv[0]);
+    std::printf("Usage: %s [--array_size v1] [--num_threads v2] "
+                "[--chunk_size v3]\n",
+                argv[0]);
     return 0;
   }
 
   int arr_size = 512 * 1024;
   int n_threads = 4;
+  int chunk_size = 4096;
   if (!get_arg_pos_i(argc, argv, "--array_size", &arr_size) ||
-      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads))
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads) ||
+      !get_arg_pos_i(argc, argv, "--chunk_size", &chunk_size))
     return 1;
 
   n_threads = std::min(n_threads, arr_size);
@@ -84,16 +141,20 @@ int main(int argc, const char **argv) {
   log_status("Run test: " __FILE__ "\n");
   log_status_param("array size", arr_size, 2);
   log_status_param("num threads", n_threads, 2);
+  log_status_param("chunk size", chunk_size, 2);
 
   bool succeed = true;
   repeat_test([&]() {
-    succeed &= test<std::uint8_t>(arr_size, n_threads);
-    succeed &= test<std::uint16_t>(arr_size, n_threads);
-    succeed &= test<std::uint32_t>(arr_size, n_threads);
-    succeed &= test<std::uint64_t>(arr_size, n_threads);
+    succeed &= test_splits<std::uint8_t>(arr_size, n_threads, chunk_size);
+    succeed &= test_splits<std::uint16_t>(arr_size, n_threads, chunk_size);
+    succeed &= test_splits<std::uint32_t>(arr_size, n_threads, chunk_size);
+    succeed &= test_splits<std::uint64_t>(arr_size, n_threads, chunk_size);
     return succeed;
   });
 
+  log_cas_stats();
+  succeed &= report_metrics(__FILE__, succeed);
+
   std::puts(succeed ? "passed" : "failed");
   return succeed ? 0 : 1;
 }
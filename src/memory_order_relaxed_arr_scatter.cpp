@@ -0,0 +1,203 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace sltts;
+
+// Threads scatter updates from input array into |n_bins| elements of
+// destination array. Destination is either a plain array updated through
+// std::atomic_ref or an array of std::atomic, at(i) returns an object with
+// std::atomic interface in both cases.
+
+template <typename T> class PlainArray {
+public:
+  explicit PlainArray(int n) : data(n, T(0)) {}
+
+  std::atomic_ref<T> at(int i) { return std::atomic_ref<T>(data[i]); }
+
+  T get(int i) const { return data[i]; }
+
+  // atomic_ref may require stronger alignment than alignof(T), vector
+  // elements are aligned for T only.
+  bool is_aligned() const {
+    const std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(data.data());
+    return addr % std::atomic_ref<T>::required_alignment == 0 &&
+           sizeof(T) % std::atomic_ref<T>::required_alignment == 0;
+  }
+
+private:
+  std::vector<T> data;
+};
+
+template <typename T> class AtomicArray {
+public:
+  explicit AtomicArray(int n) : data(n) {
+    for (std::atomic<T> &x : data)
+      x.store(T(0), std::memory_order_relaxed);
+  }
+
+  std::atomic<T> &at(int i) { return data[i]; }
+
+  T get(int i) const { return data[i].load(std::memory_order_relaxed); }
+
+  bool is_aligned() const { return true; }
+
+private:
+  std::vector<std::atomic<T>> data;
+};
+
+struct FetchAdd {
+  template <typename AtomicT, typename T> static void update(AtomicT &&x, T v) {
+    x.fetch_add(v, std::memory_order_relaxed);
+  }
+
+  template <typename T> static T apply(T lhs, T rhs) { return T(lhs + rhs); }
+};
+
+struct CasMax {
+  template <typename AtomicT, typename T> static void update(AtomicT &&x, T v) {
+    T curr_max = x.load(std::memory_order_relaxed);
+    while (v > curr_max &&
+           !x.compare_exchange_weak(curr_max, v, std::memory_order_relaxed,
+                                    std::memory_order_relaxed))
+      ;
+  }
+
+  template <typename T> static T apply(T lhs, T rhs) {
+    return std::max(lhs, rhs);
+  }
+};
+
+template <typename ArrayT, typename T, typename OpT>
+void parallel_scatter(const std::vector<T> &v, ArrayT &dst, int n_bins,
+                      int n_thr) {
+  std::atomic<bool> fence{true};
+
+  std::vector<std::thread> threads;
+  threads.reserve(n_thr);
+  for (int t = 0; t < n_thr; ++t) {
+    threads.emplace_back([t, n_thr, n_bins, &v, &dst, &fence]() {
+      const int bucket_size = v.size() / n_thr;
+      const int start_ix = t * bucket_size;
+      const int final_ix = t + 1 == n_thr ? v.size() : start_ix + bucket_size;
+
+      while (fence.load(std::memory_order_relaxed))
+        ;
+
+      for (int i = start_ix; i < final_ix; ++i)
+        OpT::update(dst.at(i % n_bins), v[i]);
+    });
+  }
+
+  fence.store(false, std::memory_order_relaxed);
+
+  for (std::thread &t : threads)
+    t.join();
+}
+
+template <typename T, template <typename> class ArrayT, typename OpT>
+bool test(const int n, int n_bins, int n_thr) {
+  std::vector<T> v(n);
+  for (int i = 0; i < n; ++i)
+    v[i] = T(i % (n / n_thr) + 1);
+
+  ArrayT<T> dst(n_bins);
+  if (!dst.is_aligned()) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("error", "array is misaligned for atomic_ref", 2);
+    return false;
+  }
+
+  const std::uint64_t start_ns = get_time_ns();
+  parallel_scatter<ArrayT<T>, T, OpT>(v, dst, n_bins, n_thr);
+  add_rate_metric(SLT_PRETTY_FUNCTION, "updates", n, get_time_ns() - start_ns);
+
+  std::vector<T> exp_res(n_bins, T(0));
+  for (int i = 0; i < n; ++i)
+    exp_res[i % n_bins] = OpT::apply(exp_res[i % n_bins], v[i]);
+
+  for (int i = 0; i < n_bins; ++i) {
+    if (dst.get(i) != exp_res[i]) {
+      log_status("Failed test\n");
+      log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+      log_status_param("array size", n, 2);
+      log_status_param("num bins", n_bins, 2);
+      log_status_param("num threads", n_thr, 2);
+      log_status_param("bin", i, 2);
+      log_status_param("act result", dst.get(i), 2);
+      log_status_param("exp result", exp_res[i], 2);
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T> bool test_arrays(int n, int n_bins, int n_thr) {
+  bool succeed = true;
+  succeed &= test<T, PlainArray, FetchAdd>(n, n_bins, n_thr);
+  succeed &= test<T, AtomicArray, FetchAdd>(n, n_bins, n_thr);
+  succeed &= test<T, PlainArray, CasMax>(n, n_bins, n_thr);
+  succeed &= test<T, AtomicArray, CasMax>(n, n_bins, n_thr);
+  return succeed;
+}
+
+template <typename T> void log_atomic_ref_params(const char *name) {
+  log_status_param(name, "", 2);
+  log_status_param("alignof", static_cast<int>(alignof(T)), 4);
+  log_status_param("atomic_ref required alignment",
+                   static_cast<int>(std::atomic_ref<T>::required_alignment), 4);
+  log_status_param("atomic_ref is always lock free",
+                   static_cast<int>(std::atomic_ref<T>::is_always_lock_free),
+                   4);
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--array_size v1] [--num_bins v2] "
+                "[--num_threads v3]\n",
+                argv[0]);
+    return 0;
+  }
+
+  int arr_size = 512 * 1024;
+  int n_bins = 64;
+  int n_threads = 4;
+  if (!get_arg_pos_i(argc, argv, "--array_size", &arr_size) ||
+      !get_arg_pos_i(argc, argv, "--num_bins", &n_bins) ||
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads))
+    return 1;
+
+  n_threads = std::min(n_threads, arr_size);
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("array size", arr_size, 2);
+  log_status_param("num bins", n_bins, 2);
+  log_status_param("num threads", n_threads, 2);
+  log_atomic_ref_params<std::uint8_t>("uint8_t");
+  log_atomic_ref_params<std::uint16_t>("uint16_t");
+  log_atomic_ref_params<std::uint32_t>("uint32_t");
+  log_atomic_ref_params<std::uint64_t>("uint64_t");
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_arrays<std::uint8_t>(arr_size, n_bins, n_threads);
+    succeed &= test_arrays<std::uint16_t>(arr_size, n_bins, n_threads);
+    succeed &= test_arrays<std::uint32_t>(arr_size, n_bins, n_threads);
+    succeed &= test_arrays<std::uint64_t>(arr_size, n_bins, n_threads);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
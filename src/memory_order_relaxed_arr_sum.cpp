@@ -1,54 +1,98 @@
+#include "metrics.h"
 #include "slt_ts.h"
 #include "utils.h"
+#include "work_split.h"
 
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <limits>
 #include <numeric>
 #include <thread>
 #include <vector>
 
 using namespace sltts;
 
-template <typename T>
-T parallel_sum(const std::vector<T> &v, int n_thr, int count) {
+struct FetchAdd {
+  template <typename T> static void add(std::atomic<T> &x, T value) {
+    x.fetch_add(value, std::memory_order_relaxed);
+  }
+};
+
+// Hand-written emulation of fetch_add, the only option for floating point
+// types before C++20.
+struct CasLoopAdd {
+  template <typename T> static void add(std::atomic<T> &x, T value) {
+    T expected = x.load(std::memory_order_relaxed);
+    while (!x.compare_exchange_weak(expected, expected + value,
+                                    std::memory_order_relaxed,
+                                    std::memory_order_relaxed))
+      ;
+  }
+};
+
+// Elements are distributed between threads by SplitT, time from start to
+// finish of every thread is written to |thread_ns|.
+template <typename T, typename AddT, typename SplitT>
+T parallel_sum(const std::vector<T> &v, int n_thr, int count, int chunk_size,
+               std::vector<std::uint64_t> *thread_ns) {
   std::atomic<T> rv{0};
   std::atomic<bool> fence{true};
+  SplitT split(v.size(), n_thr, chunk_size);
+  std::vector<std::uint64_t> finish_ns(n_thr);
 
   std::vector<std::thread> threads;
   threads.reserve(n_thr);
   for (int t = 0; t < n_thr; ++t) {
-    threads.emplace_back([t, count, n_thr, &v, &rv, &fence]() {
-      const int bucket_size = v.size() / n_thr;
-      const int start_ix = t * bucket_size;
-      const int final_ix = t + 1 == n_thr ? v.size() : start_ix + bucket_size;
-
+    threads.emplace_back([t, count, &v, &rv, &fence, &split, &finish_ns]() {
       while (fence.load(std::memory_order_relaxed))
         ;
 
-      for (int i = start_ix; i < final_ix; ++i) {
-        for (int it = 0; it < count; ++it)
-          rv.fetch_add(v[i], std::memory_order_relaxed);
+      int start_ix = 0;
+      int final_ix = 0;
+      while (split.next(t, &start_ix, &final_ix)) {
+        for (int i = start_ix; i < final_ix; ++i) {
+          for (int it = 0; it < count; ++it)
+            AddT::add(rv, v[i]);
+        }
       }
+      finish_ns[t] = get_time_ns();
     });
   }
 
-  fence.store(std::memory_order_relaxed);
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
 
   for (std::thread &t : threads)
     t.join();
 
+  thread_ns->resize(n_thr);
+  for (int t = 0; t < n_thr; ++t)
+    (*thread_ns)[t] = finish_ns[t] - start_ns;
+
   return rv.load(std::memory_order_relaxed);
 }
 
-template <typename T> bool test(const int n, int n_thr, int count) {
+// Values are small integers, so floating point sum is exact in any order
+// while it fits into the mantissa, see is_exact_fp_sum.
+template <typename T, typename AddT = FetchAdd, typename SplitT = StaticSplit>
+bool test(const int n, int n_thr, int count, int chunk_size) {
   std::vector<T> v(n);
   for (int i = 0; i < n; ++i)
     v[i] = T(i % 2 + 1);
 
-  const T act_res = parallel_sum(v, n_thr, count);
+  std::vector<std::uint64_t> thread_ns;
+  const std::uint64_t start_ns = get_time_ns();
+  const T act_res =
+      parallel_sum<T, AddT, SplitT>(v, n_thr, count, chunk_size, &thread_ns);
+  add_rate_metric(SLT_PRETTY_FUNCTION, "additions",
+                  static_cast<std::uint64_t>(n) * count,
+                  get_time_ns() - start_ns);
+  add_cost_metric(SLT_PRETTY_FUNCTION, "thread time spread (max - min) / mean",
+                  get_imbalance(thread_ns));
+
   const T exp_res = std::accumulate(v.begin(), v.end(), T(0)) * T(count);
 
   if (act_res != exp_res) {
@@ -57,6 +101,7 @@ template <typename T> bool test(const int n, int n_thr, int count) {
     log_status_param("array size", n, 2);
     log_status_param("num threads", n_thr, 2);
     log_status_param("count", count, 2);
+    log_status_param("chunk size", chunk_size, 2);
     log_status_param("act result", act_res, 2);
     log_status_param("exp result", exp_res, 2);
     return false;
@@ -64,9 +109,35 @@ template <typename T> bool test(const int n, int n_thr, int count) {
   return true;
 }
 
+template <typename T>
+bool test_splits(const int n, int n_thr, int count, int chunk_size) {
+  bool succeed = true;
+  succeed &= test<T, FetchAdd, StaticSplit>(n, n_thr, count, chunk_size);
+  succeed &= test<T, FetchAdd, ChunkedSplit>(n, n_thr, count, chunk_size);
+  succeed &= test<T, FetchAdd, StealingSplit>(n, n_thr, count, chunk_size);
+  return succeed;
+}
+
+template <typename T>
+bool test_fp_adds(const int n, int n_thr, int count, int chunk_size) {
+  bool succeed = true;
+#if defined(__cpp_lib_atomic_float)
+  succeed &= test<T, FetchAdd>(n, n_thr, count, chunk_size);
+#endif
+  succeed &= test<T, CasLoopAdd>(n, n_thr, count, chunk_size);
+  return succeed;
+}
+
+template <typename T> bool is_exact_fp_sum(int n, int count) {
+  const std::uint64_t max_sum = static_cast<std::uint64_t>(n) * 2 * count;
+  return max_sum <= (static_cast<std::uint64_t>(1)
+                     << std::numeric_limits<T>::digits);
+}
+
 int main(int argc, const char **argv) {
   if (argc == 2 && !strcmp(argv[1], "-h")) {
-    std::printf("Usage: %s [--array_size v1] [--num_threads v2] [--count v3]\n",
+    std::printf("Usage: %s [--array_size v1] [--num_threads v2] [--count v3] "
+                "[--chunk_size v4]\n",
                 argv[0]);
     return 0;
   }
@@ -74,27 +145,60 @@ int main(int argc, const char **argv) {
   int arr_size = 1024;
   int n_threads = 4;
   int count = 1000;
+  int chunk_size = 16;
   if (!get_arg_pos_i(argc, argv, "--array_size", &arr_size) ||
       !get_arg_pos_i(argc, argv, "--num_threads", &n_threads) ||
-      !get_arg_pos_i(argc, argv, "--count", &count))
+      !get_arg_pos_i(argc, argv, "--count", &count) ||
+      !get_arg_pos_i(argc, argv, "--chunk_size", &chunk_size))
     return 1;
 
   n_threads = std::min(n_threads, arr_size);
 
+  // Inexact floating point sums depend on order of additions, so they can
+  // not be compared with expected result.
+  const bool test_float = is_exact_fp_sum<float>(arr_size, count);
+  const bool test_double = is_exact_fp_sum<double>(arr_size, count);
+
   log_status("Run test: " __FILE__ "\n");
   log_status_param("array size", arr_size, 2);
   log_status_param("num threads", n_threads, 2);
   log_status_param("count", count, 2);
+  log_status_param("chunk size", chunk_size, 2);
+#if defined(__cpp_lib_atomic_float)
+  log_status_param("atomic float fetch_add", "available", 2);
+#else
+  log_status_param("atomic float fetch_add", "not available", 2);
+#endif
+  log_status_param("atomic float is lock free",
+                   static_cast<int>(std::atomic<float>().is_lock_free()), 2);
+  log_status_param("atomic double is lock free",
+                   static_cast<int>(std::atomic<double>().is_lock_free()), 2);
+  if (!test_float)
+    log_status_param("float sum", "not exact, skipped", 2);
+  if (!test_double)
+    log_status_param("double sum", "not exact, skipped", 2);
 
   bool succeed = true;
   repeat_test([&]() {
-    succeed &= test<std::uint8_t>(arr_size, n_threads, count);
-    succeed &= test<std::uint16_t>(arr_size, n_threads, count);
-    succeed &= test<std::uint32_t>(arr_size, n_threads, count);
-    succeed &= test<std::uint64_t>(arr_size, n_threads, count);
+    succeed &=
+        test_splits<std::uint8_t>(arr_size, n_threads, count, chunk_size);
+    succeed &=
+        test_splits<std::uint16_t>(arr_size, n_threads, count, chunk_size);
+    succeed &=
+        test_splits<std::uint32_t>(arr_size, n_threads, count, chunk_size);
+    succeed &=
+        test_splits<std::uint64_t>(arr_size, n_threads, count, chunk_size);
+    if (test_float)
+      succeed &=
+          test_fp_adds<float>(arr_size, n_threads, count, chunk_size);
+    if (test_double)
+      succeed &=
+          test_fp_adds<double>(arr_size, n_threads, count, chunk_size);
     return succeed;
   });
 
+  succeed &= report_metrics(__FILE__, succeed);
+
   std::puts(succeed ? "passed" : "failed");
   return succeed ? 0 : 1;
 }
@@ -1,3 +1,4 @@
+#include "metrics.h"
 #include "slt_ts.h"
 #include "utils.h"
 
@@ -79,6 +80,8 @@ int main(int argc, const char **argv) {
     return succeed;
   });
 
+  succeed &= report_metrics(__FILE__, succeed);
+
   std::puts(succeed ? "passed" : "failed");
   return succeed ? 0 : 1;
 }
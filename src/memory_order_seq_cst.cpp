@@ -1,3 +1,4 @@
+#include "metrics.h"
 #include "slt_ts.h"
 #include "utils.h"
 
@@ -77,6 +78,9 @@ template <typename T> bool test(T init_value, T signal_value) {
   t3.join();
   t4.join();
 
+  add_frequency_metric(SLT_PRETTY_FUNCTION, "both readers saw both stores",
+                       z.load() == 2, 1);
+
   if (z.load() == 0) {
     log_status("Failed test\n");
     log_status_param("function", SLT_PRETTY_FUNCTION, 2);
@@ -125,6 +129,8 @@ int main(int argc, const char **argv) {
     return succeed;
   });
 
+  succeed &= report_metrics(__FILE__, succeed);
+
   std::puts(succeed ? "passed" : "failed");
   return succeed ? 0 : 1;
 }
@@ -0,0 +1,195 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+using namespace sltts;
+
+// Dekker's and Peterson's locks for two threads with ids 0 and 1. Both rely
+// on store-load ordering: thread must not read other's flag before its own
+// flag store is visible. Only seq_cst (either on accesses or on fence between
+// store and load) gives this guarantee.
+
+template <typename T> class DekkerSeqCst {
+public:
+  void lock(int me) {
+    const int other = 1 - me;
+    SpinWait spin;
+    flag[me].store(1, std::memory_order_seq_cst);
+    while (flag[other].load(std::memory_order_seq_cst)) {
+      if (turn.load(std::memory_order_seq_cst) != T(me)) {
+        flag[me].store(0, std::memory_order_seq_cst);
+        while (turn.load(std::memory_order_seq_cst) != T(me))
+          spin.wait();
+        flag[me].store(1, std::memory_order_seq_cst);
+      } else {
+        spin.wait();
+      }
+    }
+  }
+
+  void unlock(int me) {
+    turn.store(T(1 - me), std::memory_order_seq_cst);
+    flag[me].store(0, std::memory_order_seq_cst);
+  }
+
+private:
+  std::atomic<T> flag[2] = {{0}, {0}};
+  std::atomic<T> turn{0};
+};
+
+template <typename T> class DekkerFence {
+public:
+  void lock(int me) {
+    const int other = 1 - me;
+    SpinWait spin;
+    flag[me].store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (flag[other].load(std::memory_order_relaxed)) {
+      if (turn.load(std::memory_order_relaxed) != T(me)) {
+        flag[me].store(0, std::memory_order_relaxed);
+        while (turn.load(std::memory_order_relaxed) != T(me))
+          spin.wait();
+        flag[me].store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+      } else {
+        spin.wait();
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+
+  void unlock(int me) {
+    std::atomic_thread_fence(std::memory_order_release);
+    turn.store(T(1 - me), std::memory_order_relaxed);
+    flag[me].store(0, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<T> flag[2] = {{0}, {0}};
+  std::atomic<T> turn{0};
+};
+
+template <typename T> class PetersonSeqCst {
+public:
+  void lock(int me) {
+    const int other = 1 - me;
+    SpinWait spin;
+    flag[me].store(1, std::memory_order_seq_cst);
+    turn.store(T(other), std::memory_order_seq_cst);
+    while (flag[other].load(std::memory_order_seq_cst) &&
+           turn.load(std::memory_order_seq_cst) == T(other))
+      spin.wait();
+  }
+
+  void unlock(int me) { flag[me].store(0, std::memory_order_seq_cst); }
+
+private:
+  std::atomic<T> flag[2] = {{0}, {0}};
+  std::atomic<T> turn{0};
+};
+
+template <typename T> class PetersonFence {
+public:
+  void lock(int me) {
+    const int other = 1 - me;
+    SpinWait spin;
+    flag[me].store(1, std::memory_order_relaxed);
+    // Fence after both stores only orders them against the loads below, the
+    // other thread may still see turn before flag and both enter. Flag must
+    // be visible before turn is given away.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    turn.store(T(other), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (flag[other].load(std::memory_order_relaxed) &&
+           turn.load(std::memory_order_relaxed) == T(other))
+      spin.wait();
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+
+  void unlock(int me) { flag[me].store(0, std::memory_order_release); }
+
+private:
+  std::atomic<T> flag[2] = {{0}, {0}};
+  std::atomic<T> turn{0};
+};
+
+template <typename LockT> bool test(int n) {
+  LockT lock;
+  std::uint64_t counter = 0;
+  std::atomic<bool> fence{true};
+
+  auto worker = [n, &lock, &counter, &fence](int me) {
+    while (fence.load(std::memory_order_relaxed))
+      ;
+    for (int i = 0; i < n; ++i) {
+      lock.lock(me);
+      ++counter;
+      lock.unlock(me);
+    }
+  };
+
+  std::thread t0(worker, 0);
+  std::thread t1(worker, 1);
+
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
+
+  t0.join();
+  t1.join();
+  add_rate_metric(SLT_PRETTY_FUNCTION, "acquisitions", 2ULL * n,
+                  get_time_ns() - start_ns);
+
+  const std::uint64_t exp_res = 2ULL * n;
+  if (counter != exp_res) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    log_status_param("act result", counter, 2);
+    log_status_param("exp result", exp_res, 2);
+    return false;
+  }
+  return true;
+}
+
+template <typename T> bool test_locks(int n) {
+  bool succeed = true;
+  succeed &= test<DekkerSeqCst<T>>(n);
+  succeed &= test<DekkerFence<T>>(n);
+  succeed &= test<PetersonSeqCst<T>>(n);
+  succeed &= test<PetersonFence<T>>(n);
+  return succeed;
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--count v1]\n", argv[0]);
+    return 0;
+  }
+
+  int count = 10000;
+  if (!get_arg_pos_i(argc, argv, "--count", &count))
+    return 1;
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("count", count, 2);
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_locks<std::uint8_t>(count);
+    succeed &= test_locks<std::uint16_t>(count);
+    succeed &= test_locks<std::uint32_t>(count);
+    succeed &= test_locks<std::uint64_t>(count);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+#include "metrics.h"
+
+#include "progress.h"
+#include "utils.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum class MetricKind { Rate, Frequency, Cost };
+
+const char *get_kind_str(MetricKind kind) {
+  switch (kind) {
+  case MetricKind::Rate:
+    return "rate";
+  case MetricKind::Frequency:
+    return "frequency";
+  case MetricKind::Cost:
+    return "cost";
+  }
+  return "";
+}
+
+/// Running mean and variance, Welford's algorithm.
+struct Metric {
+  MetricKind kind;
+  std::string name;
+  std::string unit;
+  std::uint64_t count;
+  double mean;
+  double m2;
+
+  double stddev() const { return count > 1 ? std::sqrt(m2 / (count - 1)) : 0.; }
+};
+
+std::vector<Metric> &get_metrics() {
+  static std::vector<Metric> metrics;
+  return metrics;
+}
+
+void add_sample(MetricKind kind, const char *name, const char *unit,
+                double value) {
+  Metric *metric = nullptr;
+  for (Metric &m : get_metrics()) {
+    if (m.kind == kind && m.name == name && m.unit == unit) {
+      metric = &m;
+      break;
+    }
+  }
+  if (!metric) {
+    get_metrics().push_back(Metric{kind, name, unit, 0, 0., 0.});
+    metric = &get_metrics().back();
+  }
+
+  ++metric->count;
+  const double delta = value - metric->mean;
+  metric->mean += delta / metric->count;
+  metric->m2 += delta * (value - metric->mean);
+}
+
+std::string get_baseline_path(const char *test_file) {
+  const char *dir = sltts::get_env("BASELINE_DIR");
+  if (!dir || !*dir)
+    return std::string();
+
+  std::string name = test_file;
+  const std::string::size_type slash = name.find_last_of("/\\");
+  if (slash != std::string::npos)
+    name.erase(0, slash + 1);
+  const std::string::size_type dot = name.rfind('.');
+  if (dot != std::string::npos)
+    name.erase(dot);
+
+  return std::string(dir) + '/' + name + ".baseline";
+}
+
+// Baseline file has a line per metric:
+// <kind> \t <count> \t <mean> \t <stddev> \t <unit> \t <name>
+// Name goes last because it is a pretty function name with spaces.
+bool save_baseline(const std::string &path) {
+  std::ofstream out(path.c_str());
+  out << std::setprecision(std::numeric_limits<double>::max_digits10);
+  for (const Metric &m : get_metrics()) {
+    out << get_kind_str(m.kind) << '\t' << m.count << '\t' << m.mean << '\t'
+        << m.stddev() << '\t' << m.unit << '\t' << m.name << '\n';
+  }
+  out.close();
+  if (!out) {
+    std::cerr << "ERROR: Failed to save baseline to " << path << '\n';
+    return false;
+  }
+  std::cout << "Baseline saved: " << path << '\n';
+  return true;
+}
+
+struct BaselineMetric {
+  std::string kind;
+  std::uint64_t count;
+  double mean;
+  double stddev;
+  std::string unit;
+  std::string name;
+};
+
+bool load_baseline(std::istream &in, const std::string &path,
+                   std::vector<BaselineMetric> *result) {
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty())
+      continue;
+    std::istringstream ss(line);
+    BaselineMetric m;
+    std::string count, mean, stddev;
+    if (!std::getline(ss, m.kind, '\t') || !std::getline(ss, count, '\t') ||
+        !std::getline(ss, mean, '\t') || !std::getline(ss, stddev, '\t') ||
+        !std::getline(ss, m.unit, '\t') || !std::getline(ss, m.name)) {
+      std::cerr << "ERROR: Malformed baseline line in " << path << ": " << line
+                << '\n';
+      return false;
+    }
+    m.count = std::strtoull(count.c_str(), nullptr, 10);
+    m.mean = std::strtod(mean.c_str(), nullptr);
+    m.stddev = std::strtod(stddev.c_str(), nullptr);
+    result->push_back(m);
+  }
+  return true;
+}
+
+bool is_regression(const Metric &act, const BaselineMetric &exp,
+                   double tolerance) {
+  const double diff = act.mean - exp.mean;
+
+  switch (act.kind) {
+  case MetricKind::Rate:
+    if (exp.mean <= 0. || -diff / exp.mean <= tolerance)
+      return false;
+    break;
+  case MetricKind::Frequency:
+    if (std::fabs(diff) <= tolerance)
+      return false;
+    break;
+  case MetricKind::Cost:
+    if (diff <= tolerance * std::fabs(exp.mean))
+      return false;
+    break;
+  }
+
+  if (act.count < 2 || exp.count < 2)
+    return true;
+
+  const double act_stddev = act.stddev();
+  const double std_err = std::sqrt(act_stddev * act_stddev / act.count +
+                                   exp.stddev * exp.stddev / exp.count);
+  return std::fabs(diff) > 3. * std_err;
+}
+
+bool check_baseline(const std::string &path) {
+  // Missing baseline file is treated like missing metrics: test added after
+  // baselines were saved is not a regression.
+  std::ifstream in(path.c_str());
+  if (!in) {
+    std::cout << "Baseline is missing: " << path << '\n';
+    return true;
+  }
+
+  std::vector<BaselineMetric> baseline;
+  if (!load_baseline(in, path, &baseline))
+    return false;
+
+  double tolerance_pct = 10.;
+  if (const char *value = sltts::get_env("BASELINE_TOLERANCE_PCT"))
+    tolerance_pct = std::atof(value);
+  const double tolerance = tolerance_pct / 100.;
+
+  bool succeed = true;
+  for (const Metric &act : get_metrics()) {
+    const BaselineMetric *exp = nullptr;
+    for (const BaselineMetric &m : baseline) {
+      if (m.kind == get_kind_str(act.kind) && m.unit == act.unit &&
+          m.name == act.name) {
+        exp = &m;
+        break;
+      }
+    }
+
+    if (!exp) {
+      std::cout << "Metric is missing in baseline: " << act.name << " ("
+                << act.unit << ")\n";
+      continue;
+    }
+
+    if (is_regression(act, *exp, tolerance)) {
+      std::cout << "Regression\n"
+                << "  metric: " << act.name << '\n'
+                << "  unit: " << act.unit << '\n'
+                << "  act result: " << act.mean << " (stddev " << act.stddev()
+                << ", runs " << act.count << ")\n"
+                << "  exp result: " << exp->mean << " (stddev " << exp->stddev
+                << ", runs " << exp->count << ")\n"
+                << "  tolerance: " << tolerance_pct << "%\n";
+      succeed = false;
+    }
+  }
+
+  std::cout << "Baseline checked: " << path << '\n';
+  return succeed;
+}
+
+} // namespace
+
+namespace sltts {
+
+void add_rate_metric(const char *name, const char *unit, std::uint64_t ops,
+                     std::uint64_t elapsed_ns) {
+  add_progress_ops(name, unit, ops, elapsed_ns);
+  if (!elapsed_ns)
+    elapsed_ns = 1;
+  add_sample(MetricKind::Rate, name, unit,
+             static_cast<double>(ops) * 1e9 / elapsed_ns);
+}
+
+void add_frequency_metric(const char *name, const char *unit,
+                          std::uint64_t hits, std::uint64_t total) {
+  add_sample(MetricKind::Frequency, name, unit,
+             total ? static_cast<double>(hits) / total : 0.);
+}
+
+void add_cost_metric(const char *name, const char *unit, double value) {
+  add_sample(MetricKind::Cost, name, unit, value);
+}
+
+bool report_metrics(const char *test_file, bool test_succeed) {
+  if (!get_metrics().empty()) {
+    std::cout << "Metrics:\n";
+    for (const Metric &m : get_metrics()) {
+      std::cout << "  " << m.name << ": " << m.mean << ' ' << m.unit
+                << (m.kind == MetricKind::Rate ? "/sec" : "") << " (stddev "
+                << m.stddev() << ", runs " << m.count << ")\n";
+    }
+  }
+
+  const std::string path = get_baseline_path(test_file);
+  if (path.empty())
+    return true;
+
+  const char *mode = get_env("BASELINE_MODE");
+  if (mode && !std::strcmp(mode, "save")) {
+    if (!test_succeed) {
+      std::cout << "Baseline is not saved for failed test: " << path << '\n';
+      return true;
+    }
+    return save_baseline(path);
+  }
+  if (mode && std::strcmp(mode, "check")) {
+    std::cerr << "ERROR: Unknown baseline mode " << mode << '\n';
+    return false;
+  }
+  return check_baseline(path);
+}
+
+} // namespace sltts
@@ -0,0 +1,53 @@
+#ifndef SLT_TS_CPPATOMICS_METRICS_H
+#define SLT_TS_CPPATOMICS_METRICS_H
+
+#include <cstdint>
+
+namespace sltts {
+
+/// Metrics are identified by |name| and |unit| pair. Every add_*_metric call
+/// adds one sample, tests call them once per run, so mean and standard
+/// deviation are computed over runs done by repeat_test. Metrics are kept in
+/// order of first registration.
+
+/// |ops| operations done in |elapsed_ns| nanoseconds. Printed as ops per
+/// second, lower value is a regression.
+void add_rate_metric(const char *name, const char *unit, std::uint64_t ops,
+                     std::uint64_t elapsed_ns);
+
+/// |hits| outcomes out of |total| observations. Printed as a fraction,
+/// change in both directions is a regression.
+void add_frequency_metric(const char *name, const char *unit,
+                          std::uint64_t hits, std::uint64_t total);
+
+/// Arbitrary |value| where lower is better, e.g. latency or imbalance.
+/// Printed as is, higher value is a regression.
+void add_cost_metric(const char *name, const char *unit, double value);
+
+/// Print accumulated metrics and save them to or compare them against
+/// baseline file. |test_file| is a test source path, usually __FILE__, its
+/// base name without extension names the baseline file. |test_succeed| is
+/// outcome of the test, baseline of failed test is not saved, since it may
+/// miss metrics of runs which did not happen. Returns false if any metric
+/// regressed against baseline or baseline failed to be parsed or saved.
+/// Missing baseline file and metrics missing in baseline are reported, but
+/// are not failures.
+///
+/// Baseline is controlled by environment variables:
+///   SLT_TS_BASELINE_DIR - directory with "<test name>.baseline" files,
+///                         baseline is not used if it is not set;
+///   SLT_TS_BASELINE_MODE - "check" (default) or "save";
+///   SLT_TS_BASELINE_TOLERANCE_PCT - allowed relative change of rates and
+///                         costs and absolute change of frequencies in
+///                         percents, default is 10.
+/// Each variable is also accepted with SLT_TS_CPPATOMICS_ prefix instead of
+/// SLT_TS_.
+///
+/// Change is a regression if it exceeds tolerance and is statistically
+/// significant, i.e. is larger than 3 standard errors of the difference of
+/// means. Metrics with single sample are compared by tolerance only.
+bool report_metrics(const char *test_file, bool test_succeed);
+
+} // namespace sltts
+
+#endif // SLT_TS_CPPATOMICS_METRICS_H
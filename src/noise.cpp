@@ -0,0 +1,280 @@
+#include "noise.h"
+
+#include "metrics.h"
+#include "utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Copies chunks between two buffers much larger than caches.
+class StreamNoise {
+public:
+  StreamNoise() : src(size, 1), dst(size) {}
+
+  std::uint64_t run() {
+    std::memcpy(&dst[offset], &src[offset], chunk_size);
+    offset = (offset + chunk_size) % size;
+    return chunk_size;
+  }
+
+  static const char *get_unit() { return "bytes"; }
+
+private:
+  static const std::size_t size = 16 << 20;
+  static const std::size_t chunk_size = 64 << 10;
+
+  std::vector<char> src;
+  std::vector<char> dst;
+  std::size_t offset = 0;
+};
+
+// Lines |stride| apart map to the same set in caches whose sets span no more
+// than |stride| bytes, |n_ways| of them exceed associativity. Every run
+// hammers one set and moves on to the next line offset, so all sets, tested
+// lines' ones included, are thrashed in turn.
+class ThrashNoise {
+public:
+  ThrashNoise() : buf(stride * n_ways) {}
+
+  std::uint64_t run() {
+    volatile unsigned char *p = buf.data();
+    for (int rep = 0; rep < n_reps; ++rep) {
+      for (int w = 0; w < n_ways; ++w)
+        ++p[w * stride + offset];
+    }
+    offset = (offset + line_size) % stride;
+    return n_reps * n_ways;
+  }
+
+  static const char *get_unit() { return "accesses"; }
+
+private:
+  static const std::size_t stride = 256 << 10;
+  static const std::size_t line_size = 64;
+  static const int n_ways = 32;
+  static const int n_reps = 16;
+
+  std::vector<unsigned char> buf;
+  std::size_t offset = 0;
+};
+
+// Increments a counter shared by all atomic noise threads.
+class AtomicNoise {
+public:
+  std::uint64_t run() {
+    for (int i = 0; i < n_incs; ++i)
+      get_counter().fetch_add(1, std::memory_order_relaxed);
+    return n_incs;
+  }
+
+  static const char *get_unit() { return "increments"; }
+
+private:
+  static const int n_incs = 256;
+
+  static std::atomic<std::uint64_t> &get_counter() {
+    struct alignas(64) Padded {
+      std::atomic<std::uint64_t> counter{0};
+    };
+    static Padded padded;
+    return padded.counter;
+  }
+};
+
+// Gives up the core and sleeps shortly, every call is a syscall and likely
+// a context switch.
+class SyscallNoise {
+public:
+  std::uint64_t run() {
+    std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::microseconds(1));
+    return 2;
+  }
+
+  static const char *get_unit() { return "calls"; }
+};
+
+// Makes noise for |duty_pct| percents of every period until |done| is set.
+// Returns amount of work done.
+template <typename NoiseT>
+std::uint64_t run_noise(int duty_pct, const std::atomic<bool> &done) {
+  const std::uint64_t period_ns = 1000000;
+  const std::uint64_t busy_ns = period_ns * duty_pct / 100;
+
+  NoiseT noise;
+  std::uint64_t work = 0;
+  while (!done.load(std::memory_order_relaxed)) {
+    const std::uint64_t start_ns = sltts::get_time_ns();
+    std::uint64_t elapsed_ns = 0;
+    do {
+      work += noise.run();
+      elapsed_ns = sltts::get_time_ns() - start_ns;
+    } while (elapsed_ns < busy_ns && !done.load(std::memory_order_relaxed));
+
+    if (elapsed_ns < period_ns)
+      std::this_thread::sleep_for(
+          std::chrono::nanoseconds(period_ns - elapsed_ns));
+  }
+  return work;
+}
+
+typedef std::uint64_t (*RunNoiseFunc)(int, const std::atomic<bool> &);
+
+struct NoiseKind {
+  const char *name;
+  const char *unit;
+  RunNoiseFunc run;
+};
+
+const NoiseKind noise_kinds[] = {
+    {"stream", StreamNoise::get_unit(), &run_noise<StreamNoise>},
+    {"thrash", ThrashNoise::get_unit(), &run_noise<ThrashNoise>},
+    {"atomic", AtomicNoise::get_unit(), &run_noise<AtomicNoise>},
+    {"syscall", SyscallNoise::get_unit(), &run_noise<SyscallNoise>},
+};
+
+struct NoiseSource {
+  const NoiseKind *kind;
+  int n_threads;
+  int duty_pct;
+};
+
+struct NoiseState {
+  std::vector<NoiseSource> sources;
+  std::vector<std::thread> threads;
+  // Source index and work of every thread.
+  std::vector<int> thread_sources;
+  std::vector<std::uint64_t> thread_work;
+  std::atomic<bool> done{false};
+  std::uint64_t start_ns = 0;
+};
+
+NoiseState &get_noise_state() {
+  static NoiseState state;
+  return state;
+}
+
+const NoiseKind *find_noise_kind(const std::string &name) {
+  for (const NoiseKind &kind : noise_kinds) {
+    if (name == kind.name)
+      return &kind;
+  }
+  return nullptr;
+}
+
+bool parse_int(const std::string &str, int min, int max, int *result) {
+  char *end = nullptr;
+  const long value = std::strtol(str.c_str(), &end, 10);
+  if (str.empty() || *end || value < min || value > max)
+    return false;
+  *result = static_cast<int>(value);
+  return true;
+}
+
+// Entry is <kind>:<threads>[:<duty pct>].
+bool parse_noise_source(const std::string &entry, NoiseSource *source) {
+  std::istringstream in(entry);
+  std::string name;
+  std::string n_threads;
+  std::string duty_pct;
+  std::getline(in, name, ':');
+  std::getline(in, n_threads, ':');
+  if (!std::getline(in, duty_pct, ':'))
+    duty_pct = "100";
+  std::string rest;
+  if (std::getline(in, rest))
+    return false;
+
+  source->kind = find_noise_kind(name);
+  return source->kind && parse_int(n_threads, 1, 1024, &source->n_threads) &&
+         parse_int(duty_pct, 1, 100, &source->duty_pct);
+}
+
+bool parse_noise_sources(const char *spec, std::vector<NoiseSource> *sources) {
+  std::istringstream in(spec);
+  std::string entry;
+  while (std::getline(in, entry, ',')) {
+    NoiseSource source;
+    if (!parse_noise_source(entry, &source))
+      return false;
+    sources->push_back(source);
+  }
+  return true;
+}
+
+} // namespace
+
+namespace sltts {
+
+void start_noise() {
+  NoiseState &state = get_noise_state();
+  const char *spec = get_env("NOISE");
+  if (!spec || !*spec || !state.threads.empty())
+    return;
+
+  if (!parse_noise_sources(spec, &state.sources)) {
+    std::cerr << "ERROR: Malformed noise configuration " << spec << '\n';
+    std::exit(1);
+  }
+
+  log_status("Noise:\n");
+  int n_threads = 0;
+  for (const NoiseSource &source : state.sources) {
+    const std::string desc = "threads " + std::to_string(source.n_threads) +
+                             ", duty " + std::to_string(source.duty_pct) +
+                             "%";
+    log_status_param(source.kind->name, desc.c_str(), 2);
+    n_threads += source.n_threads;
+  }
+
+  state.done.store(false, std::memory_order_relaxed);
+  state.thread_sources.clear();
+  state.thread_work.assign(n_threads, 0);
+  state.threads.reserve(n_threads);
+  state.start_ns = get_time_ns();
+  for (std::size_t s = 0; s < state.sources.size(); ++s) {
+    const NoiseSource source = state.sources[s];
+    for (int i = 0; i < source.n_threads; ++i) {
+      const int t = static_cast<int>(state.threads.size());
+      state.thread_sources.push_back(static_cast<int>(s));
+      state.threads.emplace_back([t, source, &state]() {
+        state.thread_work[t] = source.kind->run(source.duty_pct, state.done);
+      });
+    }
+  }
+}
+
+void stop_noise() {
+  NoiseState &state = get_noise_state();
+  if (state.threads.empty())
+    return;
+
+  state.done.store(true, std::memory_order_relaxed);
+  for (std::thread &t : state.threads)
+    t.join();
+  const std::uint64_t elapsed_ns = get_time_ns() - state.start_ns;
+
+  std::vector<std::uint64_t> source_work(state.sources.size(), 0);
+  for (std::size_t t = 0; t < state.threads.size(); ++t)
+    source_work[state.thread_sources[t]] += state.thread_work[t];
+  for (std::size_t s = 0; s < state.sources.size(); ++s) {
+    const NoiseKind *kind = state.sources[s].kind;
+    const std::string name = std::string("noise ") + kind->name;
+    add_rate_metric(name.c_str(), kind->unit, source_work[s], elapsed_ns);
+  }
+
+  state.sources.clear();
+  state.threads.clear();
+}
+
+} // namespace sltts
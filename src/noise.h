@@ -0,0 +1,27 @@
+#ifndef SLT_TS_CPPATOMICS_NOISE_H
+#define SLT_TS_CPPATOMICS_NOISE_H
+
+namespace sltts {
+
+/// Background interference threads running next to a test. Configured by
+/// SLT_TS_CPPATOMICS_NOISE or SLT_TS_NOISE environment variable as comma
+/// separated list of <kind>:<threads>[:<duty pct>] entries, for example
+/// "stream:2,atomic:4:50". Kinds:
+///   stream  - copies buffers much larger than caches (memory bandwidth),
+///   thrash  - hammers lines aliasing to the same cache sets, rotating over
+///             all sets, so tested lines are evicted too,
+///   atomic  - contends on an atomic counter unrelated to the test,
+///   syscall - yields and sleeps to churn syscalls and context switches.
+/// Duty is a percentage of every 1 ms period spent making noise, default 100.
+///
+/// Malformed configuration is reported and terminates the test.
+
+/// Start configured noise threads, does nothing if noise is not configured.
+void start_noise();
+
+/// Stop noise threads and add "noise <kind>" rate metrics of work they did.
+void stop_noise();
+
+} // namespace sltts
+
+#endif // SLT_TS_CPPATOMICS_NOISE_H
@@ -0,0 +1,222 @@
+#include "progress.h"
+
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct RateTotal {
+  std::string name;
+  std::string unit;
+  std::uint64_t ops;
+  std::uint64_t elapsed_ns;
+};
+
+struct ProgressState {
+  std::string path;
+  std::uint64_t period_ns = 0;
+  std::uint64_t start_ns = 0;
+  std::thread reporter;
+
+  // Iteration counters are updated by test thread without lock.
+  std::atomic<bool> enabled{false};
+  std::atomic<std::uint64_t> n_iterations{0};
+  std::atomic<std::uint64_t> n_failures{0};
+  std::atomic<std::uint64_t> last_iteration_ns{0};
+
+  // Guarded by |mutex|.
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  bool done = false;
+  std::vector<RateTotal> rates;
+
+#if defined(SIGUSR1)
+  void (*prev_signal_handler)(int) = SIG_DFL;
+#endif
+};
+
+ProgressState &get_progress_state() {
+  static ProgressState state;
+  return state;
+}
+
+// Set by signal handler and reset by reporter thread, lock free atomic is
+// both signal safe and free of data race between them.
+std::atomic<bool> snapshot_requested{false};
+static_assert(ATOMIC_BOOL_LOCK_FREE == 2,
+              "snapshot request flag is set in signal handler");
+
+#if defined(SIGUSR1)
+void on_snapshot_signal(int) {
+  snapshot_requested.store(true, std::memory_order_relaxed);
+}
+#endif
+
+double to_sec(std::uint64_t ns) { return static_cast<double>(ns) / 1e9; }
+
+double get_rate(std::uint64_t ops, std::uint64_t elapsed_ns) {
+  return elapsed_ns ? static_cast<double>(ops) * 1e9 / elapsed_ns : 0.;
+}
+
+// |prev_rates| are totals of the previous snapshot, they are replaced by
+// |rates| to compute current rates of the next one.
+bool write_snapshot(const ProgressState &state,
+                    const std::vector<RateTotal> &rates,
+                    std::vector<RateTotal> *prev_rates, bool finished) {
+  const std::uint64_t now_ns = sltts::get_time_ns();
+  const std::uint64_t last_ns =
+      state.last_iteration_ns.load(std::memory_order_relaxed);
+
+  const std::string tmp_path = state.path + ".tmp";
+  std::ofstream out(tmp_path.c_str());
+  out << "state: " << (finished ? "finished" : "running") << '\n'
+      << "elapsed sec: " << to_sec(now_ns - state.start_ns) << '\n'
+      << "iterations: " << state.n_iterations.load(std::memory_order_relaxed)
+      << '\n'
+      << "failures: " << state.n_failures.load(std::memory_order_relaxed)
+      << '\n'
+      << "sec since last iteration: "
+      << to_sec(now_ns - (last_ns ? last_ns : state.start_ns)) << '\n'
+      << "rates:\n";
+  for (std::size_t i = 0; i < rates.size(); ++i) {
+    const RateTotal &r = rates[i];
+    std::uint64_t ops = r.ops;
+    std::uint64_t elapsed_ns = r.elapsed_ns;
+    if (i < prev_rates->size()) {
+      ops -= (*prev_rates)[i].ops;
+      elapsed_ns -= (*prev_rates)[i].elapsed_ns;
+    }
+    out << "  " << r.name << ": " << r.ops << ' ' << r.unit << ", mean "
+        << get_rate(r.ops, r.elapsed_ns) << ' ' << r.unit << "/sec, current "
+        << get_rate(ops, elapsed_ns) << ' ' << r.unit << "/sec\n";
+  }
+  out.close();
+  *prev_rates = rates;
+
+  if (!out || std::rename(tmp_path.c_str(), state.path.c_str())) {
+    std::cerr << "ERROR: Failed to write progress to " << state.path << '\n';
+    return false;
+  }
+  return true;
+}
+
+// Wakes up every |poll| to check for signal and period, writes snapshots
+// without holding the lock.
+void run_reporter(ProgressState &state) {
+  const std::chrono::milliseconds poll(100);
+  std::vector<RateTotal> prev_rates;
+  std::uint64_t next_ns = state.start_ns + state.period_ns;
+
+  std::unique_lock<std::mutex> lock(state.mutex);
+  while (true) {
+    state.done_cv.wait_for(lock, poll);
+    const bool finished = state.done;
+    const std::uint64_t now_ns = sltts::get_time_ns();
+    const bool requested =
+        snapshot_requested.exchange(false, std::memory_order_relaxed);
+    if (!finished && !requested && now_ns < next_ns)
+      continue;
+
+    next_ns = now_ns + state.period_ns;
+    const std::vector<RateTotal> rates = state.rates;
+    lock.unlock();
+    write_snapshot(state, rates, &prev_rates, finished);
+    lock.lock();
+    if (finished)
+      break;
+  }
+}
+
+} // namespace
+
+namespace sltts {
+
+void start_progress() {
+  ProgressState &state = get_progress_state();
+  const char *path = get_env("PROGRESS_FILE");
+  if (!path || !*path || state.enabled.load(std::memory_order_relaxed))
+    return;
+
+  std::uint64_t period_sec = 10;
+  if (const char *value = get_env("PROGRESS_PERIOD_SEC"))
+    period_sec = std::max(1LL, std::atoll(value));
+
+  state.path = path;
+  state.period_ns = period_sec * 1000000000ULL;
+  state.start_ns = get_time_ns();
+  state.n_iterations.store(0, std::memory_order_relaxed);
+  state.n_failures.store(0, std::memory_order_relaxed);
+  state.last_iteration_ns.store(0, std::memory_order_relaxed);
+  state.done = false;
+  state.rates.clear();
+  state.enabled.store(true, std::memory_order_relaxed);
+
+#if defined(SIGUSR1)
+  state.prev_signal_handler = std::signal(SIGUSR1, &on_snapshot_signal);
+#endif
+
+  log_status_param("progress file", path, 2);
+  state.reporter = std::thread([&state]() { run_reporter(state); });
+}
+
+void stop_progress() {
+  ProgressState &state = get_progress_state();
+  if (!state.enabled.load(std::memory_order_relaxed))
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.done = true;
+  }
+  state.done_cv.notify_one();
+  state.reporter.join();
+  state.enabled.store(false, std::memory_order_relaxed);
+
+#if defined(SIGUSR1)
+  if (state.prev_signal_handler != SIG_ERR)
+    std::signal(SIGUSR1, state.prev_signal_handler);
+#endif
+}
+
+void add_progress_iteration(bool succeed) {
+  ProgressState &state = get_progress_state();
+  if (!state.enabled.load(std::memory_order_relaxed))
+    return;
+
+  state.n_iterations.fetch_add(1, std::memory_order_relaxed);
+  if (!succeed)
+    state.n_failures.fetch_add(1, std::memory_order_relaxed);
+  state.last_iteration_ns.store(get_time_ns(), std::memory_order_relaxed);
+}
+
+void add_progress_ops(const char *name, const char *unit, std::uint64_t ops,
+                      std::uint64_t elapsed_ns) {
+  ProgressState &state = get_progress_state();
+  if (!state.enabled.load(std::memory_order_relaxed))
+    return;
+
+  std::lock_guard<std::mutex> lock(state.mutex);
+  for (RateTotal &r : state.rates) {
+    if (r.name == name && r.unit == unit) {
+      r.ops += ops;
+      r.elapsed_ns += elapsed_ns;
+      return;
+    }
+  }
+  state.rates.push_back(RateTotal{name, unit, ops, elapsed_ns});
+}
+
+} // namespace sltts
@@ -0,0 +1,36 @@
+#ifndef SLT_TS_CPPATOMICS_PROGRESS_H
+#define SLT_TS_CPPATOMICS_PROGRESS_H
+
+#include <cstdint>
+
+namespace sltts {
+
+/// Live progress of long (soak) runs of repeat_test. Enabled by
+/// SLT_TS_PROGRESS_FILE environment variable with snapshot file path, a path
+/// in /dev/shm keeps it in shared memory. Snapshot has iterations, failures,
+/// time since last iteration and for every rate metric total ops, mean rate
+/// and current rate since previous snapshot. It is written by a background
+/// thread every SLT_TS_PROGRESS_PERIOD_SEC seconds (default 10), on SIGUSR1
+/// where signals are available and when the test is over. File is replaced
+/// atomically, so readers never see partial snapshot. Test threads only pay
+/// for a few relaxed increments per iteration.
+///
+/// Each variable is also accepted with SLT_TS_CPPATOMICS_ prefix instead of
+/// SLT_TS_.
+
+/// Start snapshot thread, does nothing if progress is not enabled.
+void start_progress();
+
+/// Write final snapshot and stop snapshot thread.
+void stop_progress();
+
+/// Record finished repeat_test iteration.
+void add_progress_iteration(bool succeed);
+
+/// Record rate metric sample, called by add_rate_metric.
+void add_progress_ops(const char *name, const char *unit, std::uint64_t ops,
+                      std::uint64_t elapsed_ns);
+
+} // namespace sltts
+
+#endif // SLT_TS_CPPATOMICS_PROGRESS_H
@@ -0,0 +1,238 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sltts;
+
+// Immutable snapshot published by writer. Readers validate that values match
+// version, writer poisons snapshot before deleting it, so reading reclaimed
+// snapshot is likely to be caught as inconsistent.
+struct Config {
+  static const int n_values = 8;
+
+  std::uint64_t version;
+  std::uint64_t values[n_values];
+
+  explicit Config(std::uint64_t v) : version(v) {
+    for (int i = 0; i < n_values; ++i)
+      values[i] = v * (i + 1);
+  }
+
+  bool is_valid() const {
+    if (!version)
+      return false;
+    for (int i = 0; i < n_values; ++i) {
+      if (values[i] != version * (i + 1))
+        return false;
+    }
+    return true;
+  }
+
+  void poison() {
+    version = 0;
+    for (std::uint64_t &v : values)
+      v = ~std::uint64_t(0);
+  }
+};
+
+// Reader announces global epoch in its slot before loading the pointer and
+// clears the slot when it is done with the snapshot. Writer retires old
+// snapshot with the epoch it was current in, bumps global epoch and deletes
+// retired snapshots older than any announced epoch. Seq_cst fences between
+// announce and pointer load (reader) and between publication and slots scan
+// (writer) guarantee that either writer sees the reader or the reader sees
+// new pointer.
+class EpochDomain {
+public:
+  explicit EpochDomain(int n_readers) : slots(n_readers) {
+    for (Slot &s : slots)
+      s.epoch.store(0, std::memory_order_relaxed);
+  }
+
+  ~EpochDomain() {
+    for (const Retired &r : retired)
+      delete r.config;
+  }
+
+  void enter(int reader) {
+    const std::uint64_t e = global_epoch.load(std::memory_order_acquire);
+    slots[reader].epoch.store(e, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void leave(int reader) {
+    slots[reader].epoch.store(0, std::memory_order_release);
+  }
+
+  // Writer only.
+  void retire(Config *config) {
+    const std::uint64_t e =
+        global_epoch.fetch_add(1, std::memory_order_acq_rel);
+    retired.push_back(Retired{config, e});
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    std::uint64_t min_epoch = e + 1;
+    for (const Slot &s : slots) {
+      const std::uint64_t reader_epoch =
+          s.epoch.load(std::memory_order_relaxed);
+      if (reader_epoch)
+        min_epoch = std::min(min_epoch, reader_epoch);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    std::vector<Retired>::iterator it = retired.begin();
+    for (; it != retired.end() && it->epoch < min_epoch; ++it) {
+      it->config->poison();
+      delete it->config;
+    }
+    retired.erase(retired.begin(), it);
+  }
+
+private:
+  struct Slot {
+    std::atomic<std::uint64_t> epoch;
+    char padding[64 - sizeof(std::atomic<std::uint64_t>)];
+  };
+
+  struct Retired {
+    Config *config;
+    std::uint64_t epoch;
+  };
+
+  std::atomic<std::uint64_t> global_epoch{1};
+  std::vector<Slot> slots;
+  std::vector<Retired> retired;
+};
+
+template <std::memory_order LoadOrder>
+bool test(int n, int n_readers, int period_us) {
+  EpochDomain domain(n_readers);
+  std::atomic<Config *> head{new Config(1)};
+  std::atomic<bool> fence{true};
+  std::atomic<bool> done{false};
+  std::atomic<bool> succeed{true};
+  std::atomic<std::uint64_t> n_reads{0};
+  std::uint64_t publish_ns = 0;
+
+  std::thread t_writer(
+      [n, period_us, &domain, &head, &fence, &done, &publish_ns]() {
+        while (fence.load(std::memory_order_relaxed))
+          ;
+        for (int i = 2; i <= n; ++i) {
+          if (period_us)
+            std::this_thread::sleep_for(std::chrono::microseconds(period_us));
+
+          const std::uint64_t start_ns = get_time_ns();
+          Config *config = new Config(i);
+          domain.retire(head.exchange(config, std::memory_order_release));
+          publish_ns += get_time_ns() - start_ns;
+        }
+        done.store(true, std::memory_order_relaxed);
+      });
+
+  std::vector<std::thread> readers;
+  readers.reserve(n_readers);
+  for (int t = 0; t < n_readers; ++t) {
+    readers.emplace_back([t, &domain, &head, &fence, &done, &succeed,
+                          &n_reads]() {
+      while (fence.load(std::memory_order_relaxed))
+        ;
+      std::uint64_t reads = 0;
+      std::uint64_t prev_version = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        domain.enter(t);
+        const Config *config = head.load(LoadOrder);
+        const std::uint64_t version = config->version;
+        const bool valid = config->is_valid() && version >= prev_version;
+        domain.leave(t);
+
+        if (!valid)
+          succeed.store(false, std::memory_order_relaxed);
+        prev_version = version;
+        ++reads;
+      }
+      n_reads.fetch_add(reads, std::memory_order_relaxed);
+    });
+  }
+
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
+
+  t_writer.join();
+  for (std::thread &t : readers)
+    t.join();
+  const std::uint64_t elapsed_ns = get_time_ns() - start_ns;
+
+  delete head.load(std::memory_order_relaxed);
+
+  const std::string name = std::string(SLT_PRETTY_FUNCTION) +
+                           ", num readers " + std::to_string(n_readers);
+  add_rate_metric(name.c_str(), "reads",
+                  n_reads.load(std::memory_order_relaxed), elapsed_ns);
+  if (n > 1)
+    add_cost_metric(name.c_str(), "ns per publish",
+                    static_cast<double>(publish_ns) / (n - 1));
+
+  if (!succeed.load(std::memory_order_relaxed)) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    log_status_param("num readers", n_readers, 2);
+    return false;
+  }
+  return true;
+}
+
+template <std::memory_order LoadOrder>
+bool test_scaling(int n, int max_n_readers, int period_us) {
+  bool succeed = true;
+  for (int n_readers = 1; n_readers < max_n_readers; n_readers *= 2)
+    succeed &= test<LoadOrder>(n, n_readers, period_us);
+  succeed &= test<LoadOrder>(n, max_n_readers, period_us);
+  return succeed;
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--count v1] [--num_threads v2] [--period_us v3]\n",
+                argv[0]);
+    return 0;
+  }
+
+  int count = 1000;
+  int n_threads = 4;
+  int period_us = 10;
+  if (!get_arg_pos_i(argc, argv, "--count", &count) ||
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads) ||
+      !get_arg_i(argc, argv, "--period_us", &period_us))
+    return 1;
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("count", count, 2);
+  log_status_param("num threads", n_threads, 2);
+  log_status_param("period us", period_us, 2);
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_scaling<std::memory_order_acquire>(count, n_threads,
+                                                       period_us);
+    succeed &= test_scaling<std::memory_order_consume>(count, n_threads,
+                                                       period_us);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
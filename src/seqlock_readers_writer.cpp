@@ -0,0 +1,224 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace sltts;
+
+template <typename T> struct Point2 {
+  T x;
+  T y;
+};
+
+template <typename T> struct Point3 {
+  T x;
+  T y;
+  T z;
+};
+
+// Writer publishes points with all coordinates equal, so torn read is a
+// point with different coordinates.
+template <typename T> Point2<T> make_point(int v, const Point2<T> *) {
+  return Point2<T>{T(v), T(v)};
+}
+
+template <typename T> Point3<T> make_point(int v, const Point3<T> *) {
+  return Point3<T>{T(v), T(v), T(v)};
+}
+
+template <typename T> bool is_torn(const Point2<T> &p) { return p.x != p.y; }
+
+template <typename T> bool is_torn(const Point3<T> &p) {
+  return p.x != p.y || p.y != p.z;
+}
+
+// Single writer seqlock. Sequence is odd while write is in progress, reader
+// retries if sequence is odd or has changed during read. Payload is stored
+// in atomic words accessed with relaxed ordering, so racy reads are not data
+// races; fences order them against sequence accesses.
+template <typename P> class SeqLock {
+public:
+  SeqLock() {
+    for (std::atomic<std::uintptr_t> &w : words)
+      w.store(0, std::memory_order_relaxed);
+  }
+
+  void store(const P &value) {
+    std::uintptr_t buf[n_words] = {};
+    std::memcpy(buf, &value, sizeof(P));
+
+    const std::uint64_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < n_words; ++i)
+      words[i].store(buf[i], std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+  }
+
+  P load(std::uint64_t *n_retries) const {
+    std::uintptr_t buf[n_words];
+    SpinWait spin;
+    while (true) {
+      const std::uint64_t s1 = seq.load(std::memory_order_acquire);
+      if (!(s1 & 1)) {
+        for (int i = 0; i < n_words; ++i)
+          buf[i] = words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq.load(std::memory_order_relaxed) == s1)
+          break;
+      }
+      ++*n_retries;
+      spin.wait();
+    }
+
+    P value;
+    std::memcpy(&value, buf, sizeof(P));
+    return value;
+  }
+
+private:
+  static const int n_words =
+      (sizeof(P) + sizeof(std::uintptr_t) - 1) / sizeof(std::uintptr_t);
+
+  std::atomic<std::uint64_t> seq{0};
+  std::atomic<std::uintptr_t> words[n_words];
+};
+
+template <typename P> class AtomicPublisher {
+public:
+  void store(const P &value) { x.store(value, std::memory_order_release); }
+
+  P load(std::uint64_t *) const { return x.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<P> x{P{}};
+};
+
+template <typename P, template <typename> class PublisherT>
+bool test(int n, int n_readers) {
+  PublisherT<P> publisher;
+  std::atomic<bool> fence{true};
+  std::atomic<bool> done{false};
+  std::atomic<bool> succeed{true};
+  std::atomic<std::uint64_t> n_reads{0};
+  std::atomic<std::uint64_t> n_retries{0};
+  std::uint64_t writer_ns = 0;
+
+  std::thread t_writer([n, &publisher, &fence, &done, &writer_ns]() {
+    while (fence.load(std::memory_order_relaxed))
+      ;
+    const std::uint64_t start_ns = get_time_ns();
+    for (int i = 0; i < n; ++i)
+      publisher.store(make_point(i, static_cast<const P *>(nullptr)));
+    writer_ns = get_time_ns() - start_ns;
+    done.store(true, std::memory_order_relaxed);
+  });
+
+  std::vector<std::thread> readers;
+  readers.reserve(n_readers);
+  for (int t = 0; t < n_readers; ++t) {
+    readers.emplace_back(
+        [&publisher, &fence, &done, &succeed, &n_reads, &n_retries]() {
+          while (fence.load(std::memory_order_relaxed))
+            ;
+          std::uint64_t reads = 0;
+          std::uint64_t retries = 0;
+          while (!done.load(std::memory_order_relaxed)) {
+            if (is_torn(publisher.load(&retries)))
+              succeed.store(false, std::memory_order_relaxed);
+            ++reads;
+          }
+          n_reads.fetch_add(reads, std::memory_order_relaxed);
+          n_retries.fetch_add(retries, std::memory_order_relaxed);
+        });
+  }
+
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
+
+  t_writer.join();
+  for (std::thread &t : readers)
+    t.join();
+  const std::uint64_t elapsed_ns = get_time_ns() - start_ns;
+
+  const std::uint64_t reads = n_reads.load(std::memory_order_relaxed);
+  const std::uint64_t retries = n_retries.load(std::memory_order_relaxed);
+  add_rate_metric(SLT_PRETTY_FUNCTION, "reads", reads, elapsed_ns);
+  add_cost_metric(SLT_PRETTY_FUNCTION, "ns per write",
+                  static_cast<double>(writer_ns) / n);
+  // Fewer retries is an improvement, so it is a cost, not a frequency.
+  add_cost_metric(SLT_PRETTY_FUNCTION, "read retries per attempt",
+                  reads + retries
+                      ? static_cast<double>(retries) / (reads + retries)
+                      : 0.);
+
+  if (!succeed.load(std::memory_order_relaxed)) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    log_status_param("num readers", n_readers, 2);
+    return false;
+  }
+  return true;
+}
+
+template <typename P> bool test_publishers(int n, int n_readers) {
+  bool succeed = true;
+  succeed &= test<P, SeqLock>(n, n_readers);
+  succeed &= test<P, AtomicPublisher>(n, n_readers);
+  return succeed;
+}
+
+template <typename P> void log_is_lock_free(const char *name) {
+  log_status_param(name, static_cast<int>(std::atomic<P>().is_lock_free()), 4);
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--count v1] [--num_threads v2]\n", argv[0]);
+    return 0;
+  }
+
+  int count = 100000;
+  int n_threads = 4;
+  if (!get_arg_pos_i(argc, argv, "--count", &count) ||
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads))
+    return 1;
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("count", count, 2);
+  log_status_param("num threads", n_threads, 2);
+  log_status_param("atomic is lock free", "", 2);
+  log_is_lock_free<Point2<std::uint8_t>>("Point2<uint8_t>");
+  log_is_lock_free<Point2<std::uint16_t>>("Point2<uint16_t>");
+  log_is_lock_free<Point2<std::uint32_t>>("Point2<uint32_t>");
+  log_is_lock_free<Point2<std::uint64_t>>("Point2<uint64_t>");
+  log_is_lock_free<Point3<std::uint8_t>>("Point3<uint8_t>");
+  log_is_lock_free<Point3<std::uint16_t>>("Point3<uint16_t>");
+  log_is_lock_free<Point3<std::uint32_t>>("Point3<uint32_t>");
+  log_is_lock_free<Point3<std::uint64_t>>("Point3<uint64_t>");
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_publishers<Point2<std::uint8_t>>(count, n_threads);
+    succeed &= test_publishers<Point2<std::uint16_t>>(count, n_threads);
+    succeed &= test_publishers<Point2<std::uint32_t>>(count, n_threads);
+    succeed &= test_publishers<Point2<std::uint64_t>>(count, n_threads);
+    succeed &= test_publishers<Point3<std::uint8_t>>(count, n_threads);
+    succeed &= test_publishers<Point3<std::uint16_t>>(count, n_threads);
+    succeed &= test_publishers<Point3<std::uint32_t>>(count, n_threads);
+    succeed &= test_publishers<Point3<std::uint64_t>>(count, n_threads);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
@@ -0,0 +1,353 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace sltts;
+
+static void log_error(const char *func) {
+  std::fprintf(stderr, "ERROR: %s failed: %s\n", func, std::strerror(errno));
+}
+
+// POSIX shared memory object. It is unlinked right after creation, so it
+// lives while descriptor and mappings are alive and does not leak if test
+// crashes. Forked processes map it again at their own addresses, so atomics
+// are accessed through different virtual addresses, as it happens with
+// unrelated processes sharing /dev/shm.
+class SharedMemory {
+public:
+  explicit SharedMemory(std::size_t size) : size(size) {
+    static int n_objects = 0;
+    const std::string name = "/slt_ts_cppatomics_" + std::to_string(getpid()) +
+                             "_" + std::to_string(n_objects++);
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+      log_error("shm_open");
+      return;
+    }
+    shm_unlink(name.c_str());
+    if (ftruncate(fd, size) != 0) {
+      log_error("ftruncate");
+      return;
+    }
+    addr = map_view();
+    if (!addr)
+      log_error("mmap");
+  }
+
+  ~SharedMemory() {
+    if (addr)
+      munmap(addr, size);
+    if (fd >= 0)
+      close(fd);
+  }
+
+  void *data() const { return addr; }
+
+  // New mapping of the same object, it is unmapped on process exit. Does not
+  // log, so forked child can call it.
+  void *map_view() const {
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    return p == MAP_FAILED ? nullptr : p;
+  }
+
+private:
+  std::size_t size;
+  int fd = -1;
+  void *addr = nullptr;
+};
+
+// Runners start participants which get index and pointer to shared state and
+// return false on failure. ThreadRunner runs threads of this process on the
+// same mapping, ProcessRunner forks processes with their own mappings.
+// Participants may wait for each other, so if spawn fails, caller stops
+// spawning and does not release them, join_all then reports failure.
+
+class ThreadRunner {
+public:
+  explicit ThreadRunner(const SharedMemory &shm) : shm(shm) {}
+
+  template <typename FuncT> bool spawn(int i, FuncT func) {
+    results.push_back(0);
+    threads.emplace_back([this, i, func]() {
+      results[i] = func(i, shm.data()) ? 1 : 0;
+    });
+    return true;
+  }
+
+  bool join_all() {
+    for (std::thread &t : threads)
+      t.join();
+    bool succeed = true;
+    for (char r : results)
+      succeed &= r != 0;
+    return succeed;
+  }
+
+  void reserve(int n) {
+    threads.reserve(n);
+    results.reserve(n);
+  }
+
+private:
+  const SharedMemory &shm;
+  std::vector<std::thread> threads;
+  std::vector<char> results;
+};
+
+class ProcessRunner {
+public:
+  explicit ProcessRunner(const SharedMemory &shm) : shm(shm) {}
+
+  // Child only reports exit status: parent may have other threads, so
+  // stdio is not safe to use after fork. _exit does not flush stdio buffers
+  // inherited from parent either.
+  template <typename FuncT> bool spawn(int i, FuncT func) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      void *view = shm.map_view();
+      _exit(view && func(i, view) ? 0 : 1);
+    }
+    if (pid < 0) {
+      log_error("fork");
+      spawn_failed = true;
+      return false;
+    }
+    pids.push_back(pid);
+    return true;
+  }
+
+  // Children are reaped in order of exit. Once any of them fails, the rest
+  // may wait for it forever, so they are killed.
+  bool join_all() {
+    bool succeed = !spawn_failed;
+    if (!succeed)
+      kill_all();
+    while (!pids.empty()) {
+      int status = 0;
+      const pid_t pid = waitpid(-1, &status, 0);
+      if (pid < 0) {
+        if (errno == EINTR)
+          continue;
+        log_error("waitpid");
+        return false;
+      }
+      const std::vector<pid_t>::iterator it =
+          std::find(pids.begin(), pids.end(), pid);
+      if (it == pids.end())
+        continue;
+      pids.erase(it);
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        if (succeed)
+          kill_all();
+        succeed = false;
+      }
+    }
+    return succeed;
+  }
+
+  void reserve(int n) { pids.reserve(n); }
+
+private:
+  // Kills children which are not reaped yet, so their pids are not reused.
+  void kill_all() {
+    for (pid_t pid : pids)
+      kill(pid, SIGKILL);
+  }
+
+  const SharedMemory &shm;
+  std::vector<pid_t> pids;
+  bool spawn_failed = false;
+};
+
+template <typename T> struct CounterState {
+  std::atomic<bool> fence{true};
+  std::atomic<T> counter{0};
+};
+
+template <typename T, typename RunnerT> bool test_counter(int n, int n_par) {
+  SharedMemory shm(sizeof(CounterState<T>));
+  if (!shm.data())
+    return false;
+  CounterState<T> *state = new (shm.data()) CounterState<T>();
+
+  RunnerT runner(shm);
+  runner.reserve(n_par);
+  bool spawned = true;
+  for (int p = 0; p < n_par && spawned; ++p) {
+    spawned = runner.spawn(p, [n](int, void *view) {
+      CounterState<T> *s = static_cast<CounterState<T> *>(view);
+      SpinWait spin;
+      while (s->fence.load(std::memory_order_relaxed))
+        spin.wait();
+      for (int i = 0; i < n; ++i)
+        s->counter.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    });
+  }
+
+  const std::uint64_t start_ns = get_time_ns();
+  if (spawned)
+    state->fence.store(false, std::memory_order_relaxed);
+  const bool joined = runner.join_all();
+  add_rate_metric(SLT_PRETTY_FUNCTION, "increments",
+                  static_cast<std::uint64_t>(n) * n_par,
+                  get_time_ns() - start_ns);
+
+  const T act_res = state->counter.load(std::memory_order_relaxed);
+  const T exp_res = T(T(n) * T(n_par));
+  state->~CounterState<T>();
+
+  if (!joined || act_res != exp_res) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    log_status_param("num participants", n_par, 2);
+    log_status_param("act result", act_res, 2);
+    log_status_param("exp result", exp_res, 2);
+    return false;
+  }
+  return true;
+}
+
+// Producer writes non-atomic data and publishes round number with release
+// store, consumer acquires it, checks data and acknowledges the round.
+template <typename T> struct HandoffState {
+  std::atomic<bool> fence{true};
+  std::atomic<T> round{0};
+  std::atomic<T> ack{0};
+  int data = 0;
+};
+
+template <typename T, typename RunnerT> bool test_handoff(int n) {
+  SharedMemory shm(sizeof(HandoffState<T>));
+  if (!shm.data())
+    return false;
+  HandoffState<T> *state = new (shm.data()) HandoffState<T>();
+
+  auto producer = [n](int, void *view) {
+    HandoffState<T> *s = static_cast<HandoffState<T> *>(view);
+    SpinWait spin;
+    while (s->fence.load(std::memory_order_relaxed))
+      spin.wait();
+    for (int i = 1; i <= n; ++i) {
+      s->data = i;
+      s->round.store(T(i), std::memory_order_release);
+      while (s->ack.load(std::memory_order_acquire) != T(i))
+        spin.wait();
+    }
+    return true;
+  };
+  auto consumer = [n](int, void *view) {
+    HandoffState<T> *s = static_cast<HandoffState<T> *>(view);
+    SpinWait spin;
+    bool succeed = true;
+    for (int i = 1; i <= n; ++i) {
+      while (s->round.load(std::memory_order_acquire) != T(i))
+        spin.wait();
+      succeed &= s->data == i;
+      s->ack.store(T(i), std::memory_order_release);
+    }
+    return succeed;
+  };
+
+  RunnerT runner(shm);
+  runner.reserve(2);
+  const bool spawned =
+      runner.spawn(0, producer) && runner.spawn(1, consumer);
+
+  const std::uint64_t start_ns = get_time_ns();
+  if (spawned)
+    state->fence.store(false, std::memory_order_relaxed);
+  const bool succeed = runner.join_all();
+  const std::uint64_t elapsed_ns = get_time_ns() - start_ns;
+  state->~HandoffState<T>();
+
+  // Every round is two handoffs: data to consumer and ack to producer.
+  add_cost_metric(SLT_PRETTY_FUNCTION, "ns per handoff",
+                  static_cast<double>(elapsed_ns) / (2. * n));
+
+  if (!succeed) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    return false;
+  }
+  return true;
+}
+
+// Atomics which are not lock free are implemented with locks private to
+// the process, they are not expected to work across processes.
+template <typename T> bool test_runners(int n, int n_par, int n_rounds) {
+  bool succeed = true;
+  succeed &= test_counter<T, ThreadRunner>(n, n_par);
+  succeed &= test_handoff<T, ThreadRunner>(n_rounds);
+  if (std::atomic<T>().is_lock_free()) {
+    succeed &= test_counter<T, ProcessRunner>(n, n_par);
+    succeed &= test_handoff<T, ProcessRunner>(n_rounds);
+  }
+  return succeed;
+}
+
+template <typename T> void log_is_lock_free(const char *name) {
+  log_status_param(name, static_cast<int>(std::atomic<T>().is_lock_free()), 4);
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--count v1] [--num_threads v2] [--rounds v3]\n",
+                argv[0]);
+    return 0;
+  }
+
+  int count = 100000;
+  int n_threads = 4;
+  int n_rounds = 10000;
+  if (!get_arg_pos_i(argc, argv, "--count", &count) ||
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads) ||
+      !get_arg_pos_i(argc, argv, "--rounds", &n_rounds))
+    return 1;
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("count", count, 2);
+  log_status_param("num threads", n_threads, 2);
+  log_status_param("rounds", n_rounds, 2);
+  log_status_param("atomic is lock free", "", 2);
+  log_is_lock_free<std::uint8_t>("uint8_t");
+  log_is_lock_free<std::uint16_t>("uint16_t");
+  log_is_lock_free<std::uint32_t>("uint32_t");
+  log_is_lock_free<std::uint64_t>("uint64_t");
+
+  // Children inherit unflushed output otherwise.
+  std::fflush(stdout);
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_runners<std::uint8_t>(count, n_threads, n_rounds);
+    succeed &= test_runners<std::uint16_t>(count, n_threads, n_rounds);
+    succeed &= test_runners<std::uint32_t>(count, n_threads, n_rounds);
+    succeed &= test_runners<std::uint64_t>(count, n_threads, n_rounds);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
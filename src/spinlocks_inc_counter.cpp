@@ -0,0 +1,247 @@
+#include "metrics.h"
+#include "slt_ts.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sltts;
+
+// Every lock has lock(Node &) and unlock(Node &) methods, where Node is a
+// per-thread state of the lock. Only MCS lock uses it, it is a queue entry.
+
+class TasLock {
+public:
+  struct Node {};
+
+  void lock(Node &) {
+    SpinWait spin;
+    while (flag.exchange(true, std::memory_order_acquire))
+      spin.wait();
+  }
+
+  void unlock(Node &) { flag.store(false, std::memory_order_release); }
+
+private:
+  std::atomic<bool> flag{false};
+};
+
+class TtasBackoffLock {
+public:
+  struct Node {};
+
+  void lock(Node &) {
+    int delay = min_delay;
+    while (true) {
+      SpinWait spin;
+      while (flag.load(std::memory_order_relaxed))
+        spin.wait();
+      if (!flag.exchange(true, std::memory_order_acquire))
+        return;
+
+      // Lost the race for the lock, back off exponentially before retry.
+      for (int i = 0; i < delay; ++i)
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+      if (delay < max_delay)
+        delay *= 2;
+      else
+        std::this_thread::yield();
+    }
+  }
+
+  void unlock(Node &) { flag.store(false, std::memory_order_release); }
+
+private:
+  static const int min_delay = 4;
+  static const int max_delay = 1024;
+
+  std::atomic<bool> flag{false};
+};
+
+// Tickets wrap around, it is fine while there are less threads than values
+// of T.
+template <typename T> class TicketLock {
+public:
+  struct Node {};
+
+  void lock(Node &) {
+    SpinWait spin;
+    const T ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+    while (now_serving.load(std::memory_order_acquire) != ticket)
+      spin.wait();
+  }
+
+  void unlock(Node &) {
+    // Only lock owner writes now_serving, so load + store is fine here.
+    const T serving = now_serving.load(std::memory_order_relaxed);
+    now_serving.store(T(serving + 1), std::memory_order_release);
+  }
+
+private:
+  std::atomic<T> next_ticket{0};
+  std::atomic<T> now_serving{0};
+};
+
+class McsLock {
+public:
+  struct Node {
+    std::atomic<Node *> next{nullptr};
+    std::atomic<bool> locked{false};
+  };
+
+  void lock(Node &node) {
+    node.next.store(nullptr, std::memory_order_relaxed);
+    node.locked.store(true, std::memory_order_relaxed);
+
+    Node *prev = tail.exchange(&node, std::memory_order_acq_rel);
+    if (!prev)
+      return;
+
+    prev->next.store(&node, std::memory_order_release);
+    SpinWait spin;
+    while (node.locked.load(std::memory_order_acquire))
+      spin.wait();
+  }
+
+  void unlock(Node &node) {
+    Node *next = node.next.load(std::memory_order_acquire);
+    if (!next) {
+      Node *expected = &node;
+      if (tail.compare_exchange_strong(expected, nullptr,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed))
+        return;
+
+      // Successor has swapped tail but not linked itself yet.
+      SpinWait spin;
+      while (!(next = node.next.load(std::memory_order_acquire)))
+        spin.wait();
+    }
+    next->locked.store(false, std::memory_order_release);
+  }
+
+private:
+  std::atomic<Node *> tail{nullptr};
+};
+
+// Threads acquire the lock until |n| * |n_thr| increments of non-atomic
+// counter are done. Each thread counts its own acquisitions, their spread
+// shows lock fairness.
+template <typename LockT> bool test(int n, int n_thr) {
+  const std::uint64_t total = static_cast<std::uint64_t>(n) * n_thr;
+
+  LockT lock;
+  std::uint64_t counter = 0;
+  std::atomic<bool> fence{true};
+  std::vector<std::uint64_t> acquisitions(n_thr, 0);
+
+  std::vector<std::thread> threads;
+  threads.reserve(n_thr);
+  for (int t = 0; t < n_thr; ++t) {
+    threads.emplace_back([t, total, &lock, &counter, &fence, &acquisitions]() {
+      typename LockT::Node node;
+      std::uint64_t my_acquisitions = 0;
+
+      while (fence.load(std::memory_order_relaxed))
+        ;
+
+      while (true) {
+        lock.lock(node);
+        if (counter == total) {
+          lock.unlock(node);
+          break;
+        }
+        ++counter;
+        lock.unlock(node);
+        ++my_acquisitions;
+      }
+      acquisitions[t] = my_acquisitions;
+    });
+  }
+
+  const std::uint64_t start_ns = get_time_ns();
+  fence.store(false, std::memory_order_relaxed);
+
+  for (std::thread &t : threads)
+    t.join();
+  const std::uint64_t elapsed_ns = get_time_ns() - start_ns;
+
+  std::uint64_t sum_acquisitions = 0;
+  for (std::uint64_t a : acquisitions)
+    sum_acquisitions += a;
+  const auto minmax =
+      std::minmax_element(acquisitions.begin(), acquisitions.end());
+  const double spread =
+      static_cast<double>(*minmax.second - *minmax.first) * n_thr / total;
+
+  const std::string name = std::string(SLT_PRETTY_FUNCTION) + ", num threads " +
+                           std::to_string(n_thr);
+  add_rate_metric(name.c_str(), "acquisitions", total, elapsed_ns);
+  add_cost_metric(name.c_str(), "acquisitions spread (max - min) / mean",
+                  spread);
+
+  if (counter != total || sum_acquisitions != total) {
+    log_status("Failed test\n");
+    log_status_param("function", SLT_PRETTY_FUNCTION, 2);
+    log_status_param("count", n, 2);
+    log_status_param("num threads", n_thr, 2);
+    log_status_param("act result", counter, 2);
+    log_status_param("act acquisitions", sum_acquisitions, 2);
+    log_status_param("exp result", total, 2);
+    return false;
+  }
+  return true;
+}
+
+template <typename LockT> bool test_scaling(int n, int max_n_thr) {
+  bool succeed = true;
+  for (int n_thr = 1; n_thr < max_n_thr; n_thr *= 2)
+    succeed &= test<LockT>(n, n_thr);
+  succeed &= test<LockT>(n, max_n_thr);
+  return succeed;
+}
+
+int main(int argc, const char **argv) {
+  if (argc == 2 && !strcmp(argv[1], "-h")) {
+    std::printf("Usage: %s [--count v1] [--num_threads v2]\n", argv[0]);
+    return 0;
+  }
+
+  int count = 10000;
+  int n_threads = 4;
+  if (!get_arg_pos_i(argc, argv, "--count", &count) ||
+      !get_arg_pos_i(argc, argv, "--num_threads", &n_threads))
+    return 1;
+
+  log_status("Run test: " __FILE__ "\n");
+  log_status_param("count", count, 2);
+  log_status_param("num threads", n_threads, 2);
+
+  // Tickets of TicketLock<std::uint8_t> collide with 256 threads or more.
+  const int n_uint8_ticket_threads = std::min(n_threads, 255);
+  if (n_uint8_ticket_threads < n_threads)
+    log_status_param("num threads of TicketLock<uint8_t>",
+                     n_uint8_ticket_threads, 2);
+
+  bool succeed = true;
+  repeat_test([&]() {
+    succeed &= test_scaling<TasLock>(count, n_threads);
+    succeed &= test_scaling<TtasBackoffLock>(count, n_threads);
+    succeed &= test_scaling<TicketLock<std::uint8_t>>(count,
+                                                      n_uint8_ticket_threads);
+    succeed &= test_scaling<TicketLock<std::uint32_t>>(count, n_threads);
+    succeed &= test_scaling<McsLock>(count, n_threads);
+    return succeed;
+  });
+
+  succeed &= report_metrics(__FILE__, succeed);
+
+  std::puts(succeed ? "passed" : "failed");
+  return succeed ? 0 : 1;
+}
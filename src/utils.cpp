@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 static std::uint64_t get_current_time_ms() {
   using namespace std::chrono;
@@ -46,6 +47,7 @@ INSTANTIATE_LOG_STATUS_PARAM(int);
 INSTANTIATE_LOG_STATUS_PARAM(std::uint16_t);
 INSTANTIATE_LOG_STATUS_PARAM(std::uint32_t);
 INSTANTIATE_LOG_STATUS_PARAM(std::uint64_t);
+INSTANTIATE_LOG_STATUS_PARAM(double);
 #undef INSTANTIATE_LOG_STATUS_PARAM
 
 void log_status_param(const char *name, std::uint8_t value, int indent) {
@@ -54,6 +56,20 @@ void log_status_param(const char *name, std::uint8_t value, int indent) {
   std::cout << name << ": " << static_cast<int>(value) << '\n';
 }
 
+std::uint64_t get_time_ns() {
+  using namespace std::chrono;
+  auto dur = steady_clock::now().time_since_epoch();
+  return duration_cast<nanoseconds>(dur).count();
+}
+
+const char *get_env(const char *key) {
+  const std::string long_key = std::string("SLT_TS_CPPATOMICS_") + key;
+  if (const char *value = std::getenv(long_key.c_str()))
+    return value;
+  const std::string short_key = std::string("SLT_TS_") + key;
+  return std::getenv(short_key.c_str());
+}
+
 bool get_arg_i(int argc, const char **argv, const char *name, int *result) {
   for (int i = 1; i + 1 < argc; ++i) {
     if (strcmp(name, argv[i]))
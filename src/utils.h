@@ -1,7 +1,12 @@
 #ifndef SLT_TS_CPPATOMICS_UTILS_H
 #define SLT_TS_CPPATOMICS_UTILS_H
 
+#include "metrics.h"
+#include "noise.h"
+#include "progress.h"
+
 #include <cstdint>
+#include <thread>
 
 namespace sltts {
 
@@ -12,6 +17,14 @@ void log_status_param(const char *name, std::uint8_t value, int indent = 0);
 void log_status_param(const char *name, std::uint16_t value, int indent = 0);
 void log_status_param(const char *name, std::uint32_t value, int indent = 0);
 void log_status_param(const char *name, std::uint64_t value, int indent = 0);
+void log_status_param(const char *name, double value, int indent = 0);
+
+/// Monotonic time in nanoseconds. Use differences only.
+std::uint64_t get_time_ns();
+
+/// Value of SLT_TS_CPPATOMICS_<key> environment variable or, if it is not
+/// set, of SLT_TS_<key>. Returns nullptr if neither is set.
+const char *get_env(const char *key);
 
 /// Arguments parsers are not designed neither for fully functional
 /// boost::program_options analogue nor for fast parsing. It is just fast enough
@@ -40,10 +53,41 @@ private:
   std::uint64_t min_testing_time_ms;
 };
 
+/// Backoff for spin loops waiting for other thread. Spins for a while and
+/// then yields, so waiting threads do not burn whole time slices when there
+/// are fewer cores than threads.
+class SpinWait {
+public:
+  void wait() {
+    if (++n_spins < max_spins)
+      return;
+    n_spins = 0;
+    std::this_thread::yield();
+  }
+
+private:
+  static const int max_spins = 1024;
+  int n_spins = 0;
+};
+
+/// Run |func| until it fails or min testing time is over. Every run adds a
+/// sample to "test iteration" rate metric. Configured background noise runs
+/// for the whole time, see noise.h, and live progress is published, see
+/// progress.h.
 template<typename FuncT> void repeat_test(FuncT &&func) {
+  start_noise();
+  start_progress();
   RepeatTestTimer timer;
-  while(func() && timer.should_continue())
-    ;
+  bool succeed = true;
+  do {
+    const std::uint64_t start_ns = get_time_ns();
+    succeed = func();
+    add_rate_metric("test iteration", "iterations", 1,
+                    get_time_ns() - start_ns);
+    add_progress_iteration(succeed);
+  } while (succeed && timer.should_continue());
+  stop_progress();
+  stop_noise();
 }
 
 } // namespace sltts
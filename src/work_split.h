@@ -0,0 +1,122 @@
+#ifndef SLT_TS_CPPATOMICS_WORK_SPLIT_H
+#define SLT_TS_CPPATOMICS_WORK_SPLIT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace sltts {
+
+/// Distributions of [0, size) index range between |n_thr| threads. Thread |t|
+/// calls next(t, &begin, &end) until it returns false and processes every
+/// returned [begin, end) range. Each split object is used for one run.
+
+/// Fixed equal buckets, the last thread takes the remainder.
+class StaticSplit {
+public:
+  StaticSplit(int size, int n_thr, int /*chunk_size*/)
+      : size(size), n_thr(n_thr), taken(n_thr, 0) {}
+
+  bool next(int t, int *begin, int *end) {
+    if (taken[t])
+      return false;
+    taken[t] = 1;
+    const int bucket_size = size / n_thr;
+    *begin = t * bucket_size;
+    *end = t + 1 == n_thr ? size : *begin + bucket_size;
+    return true;
+  }
+
+private:
+  int size;
+  int n_thr;
+  std::vector<char> taken;
+};
+
+/// Threads claim chunks of |chunk_size| from shared atomic index. Index is
+/// 64-bit, so claims past the end by all threads can not wrap it.
+class ChunkedSplit {
+public:
+  ChunkedSplit(int size, int /*n_thr*/, int chunk_size)
+      : size(size), chunk_size(std::min(chunk_size, std::max(size, 1))) {}
+
+  bool next(int, int *begin, int *end) {
+    const std::int64_t b =
+        next_ix.fetch_add(chunk_size, std::memory_order_relaxed);
+    if (b >= size)
+      return false;
+    *begin = static_cast<int>(b);
+    *end = static_cast<int>(std::min<std::int64_t>(size, b + chunk_size));
+    return true;
+  }
+
+private:
+  int size;
+  int chunk_size;
+  std::atomic<std::int64_t> next_ix{0};
+};
+
+/// Static buckets with per-bucket atomic index. Thread claims chunks from
+/// its own bucket first and then steals chunks from other buckets. Indices
+/// are 64-bit, so claims past the end of a bucket can not wrap them.
+class StealingSplit {
+public:
+  StealingSplit(int size, int n_thr, int chunk_size)
+      : n_thr(n_thr), chunk_size(std::min(chunk_size, std::max(size, 1))),
+        buckets(n_thr) {
+    const int bucket_size = size / n_thr;
+    for (int t = 0; t < n_thr; ++t) {
+      buckets[t].next_ix.store(t * bucket_size, std::memory_order_relaxed);
+      buckets[t].final_ix =
+          t + 1 == n_thr ? size : (t + 1) * bucket_size;
+    }
+  }
+
+  bool next(int t, int *begin, int *end) {
+    for (int i = 0; i < n_thr; ++i) {
+      Bucket &bucket = buckets[(t + i) % n_thr];
+      if (bucket.next_ix.load(std::memory_order_relaxed) >= bucket.final_ix)
+        continue;
+      const std::int64_t b =
+          bucket.next_ix.fetch_add(chunk_size, std::memory_order_relaxed);
+      if (b >= bucket.final_ix)
+        continue;
+      *begin = static_cast<int>(b);
+      *end = static_cast<int>(
+          std::min<std::int64_t>(bucket.final_ix, b + chunk_size));
+      return true;
+    }
+    return false;
+  }
+
+private:
+  // Padding keeps hot indices of neighbor buckets on different cache lines.
+  struct Bucket {
+    std::atomic<std::int64_t> next_ix;
+    int final_ix;
+    char padding[64 - sizeof(std::atomic<std::int64_t>) - sizeof(int)];
+  };
+
+  int n_thr;
+  int chunk_size;
+  std::vector<Bucket> buckets;
+};
+
+/// Load imbalance of threads by their elapsed times: (max - min) / mean.
+inline double get_imbalance(const std::vector<std::uint64_t> &thread_ns) {
+  if (thread_ns.empty())
+    return 0.;
+  std::uint64_t sum = 0;
+  for (std::uint64_t ns : thread_ns)
+    sum += ns;
+  if (!sum)
+    return 0.;
+  const auto minmax = std::minmax_element(thread_ns.begin(), thread_ns.end());
+  return static_cast<double>(*minmax.second - *minmax.first) *
+         thread_ns.size() / sum;
+}
+
+} // namespace sltts
+
+#endif // SLT_TS_CPPATOMICS_WORK_SPLIT_H